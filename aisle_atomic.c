@@ -0,0 +1,79 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * The functions in aisle_manager.c read *aisle, compute a new bit pattern and
+ * write it back, so two threads updating sections of the same aisle at the
+ * same time can overwrite each other's change. The versions here are safe to
+ * call concurrently on the same aisle without a lock.
+ *
+ * Each update applies the existing aisle_manager.c function to a local copy
+ * of the aisle and publishes the result with a 64-bit compare-and-swap. If
+ * another thread changed the aisle in between, the CAS fails, hands back the
+ * current value and the update is recomputed from it. Updates to different
+ * sections of one aisle therefore never lose each other's changes, and
+ * updates to the same section behave as if they ran one after another.
+ * Toggling a space is a single fetch-and-xor and never retries. An update
+ * that would not change the aisle does not write it at all.
+ */
+
+#include "aisle_atomic.h"
+#include "aisle_manager.h"
+
+/*
+ * CAS_UPDATE - Runs the statement update on the local copy "next" of the
+ *     value "prev" loaded from *aisle and stores next back atomically,
+ *     retrying from the current value of *aisle until no other thread got in
+ *     between. Leaves the value that was replaced in prev.
+ */
+#define CAS_UPDATE(aisle, prev, next, update)                               \
+  do {                                                                      \
+    prev = __atomic_load_n(aisle, __ATOMIC_RELAXED);                        \
+    do {                                                                    \
+      next = prev;                                                          \
+      update;                                                               \
+      if (next == prev) {                                                   \
+        break;                                                              \
+      }                                                                     \
+    } while (!__atomic_compare_exchange_n(aisle, &prev, next, 1,            \
+                                          __ATOMIC_ACQ_REL,                 \
+                                          __ATOMIC_RELAXED));               \
+  } while (0)
+
+
+void atomic_set_section(unsigned long* aisle, int index,
+                        unsigned short new_section) {
+  unsigned long prev, next;
+  CAS_UPDATE(aisle, prev, next, set_section(&next, index, new_section));
+}
+
+void atomic_set_spaces(unsigned long* aisle, int index,
+                       unsigned short new_spaces) {
+  unsigned long prev, next;
+  CAS_UPDATE(aisle, prev, next, set_spaces(&next, index, new_spaces));
+}
+
+void atomic_set_id(unsigned long* aisle, int index, unsigned short new_id) {
+  unsigned long prev, next;
+  CAS_UPDATE(aisle, prev, next, set_id(&next, index, new_id));
+}
+
+int atomic_toggle_space(unsigned long* aisle, int index, int space_index) {
+  unsigned long bit = 1UL << (16 * index + space_index);
+  unsigned long prev = __atomic_fetch_xor(aisle, bit, __ATOMIC_ACQ_REL);
+  return (prev & bit) == 0;
+}
+
+int atomic_add_items(unsigned long* aisle, int index, int n) {
+  unsigned long prev, next;
+  CAS_UPDATE(aisle, prev, next, add_items(&next, index, n));
+  return num_items(&next, index) - num_items(&prev, index);
+}
+
+int atomic_remove_items(unsigned long* aisle, int index, int n) {
+  unsigned long prev, next;
+  CAS_UPDATE(aisle, prev, next, remove_items(&next, index, n));
+  return num_items(&prev, index) - num_items(&next, index);
+}
@@ -0,0 +1,29 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Atomic versions of the aisle_manager.c updates, for aisles shared between
+ * threads. See aisle_atomic.c for details.
+ */
+
+#ifndef AISLE_ATOMIC_H
+#define AISLE_ATOMIC_H
+
+/* Same as the aisle_manager.c functions of the same name without the atomic_
+ * prefix, but the whole read-modify-write of *aisle happens atomically. */
+void atomic_set_section(unsigned long* aisle, int index,
+                        unsigned short new_section);
+void atomic_set_spaces(unsigned long* aisle, int index,
+                       unsigned short new_spaces);
+void atomic_set_id(unsigned long* aisle, int index, unsigned short new_id);
+
+/* Atomically toggles the given space. Returns 1 if the space now holds an
+ * item and 0 if it is now empty. */
+int atomic_toggle_space(unsigned long* aisle, int index, int space_index);
+
+/* Atomically adds / removes at most n items, like add_items / remove_items.
+ * Returns how many items this call actually added / removed, which other
+ * threads updating the same section may make less than n. */
+int atomic_add_items(unsigned long* aisle, int index, int n);
+int atomic_remove_items(unsigned long* aisle, int index, int n);
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Contention benchmark for aisle_atomic.c. Every thread works on its own
+ * section (thread t uses section t % 4) and repeatedly adds an item, toggles
+ * a space of its section twice and removes an item, so a correct run leaves
+ * the aisle exactly as it started. Three ways of updating are compared:
+ *
+ *   plain   the aisle_manager.c functions with no synchronization at all;
+ *           updates are lost as soon as two threads share an aisle
+ *   mutex   the aisle_manager.c functions under one pthread mutex
+ *   atomic  the CAS / fetch-xor versions from aisle_atomic.c
+ *
+ * By default all threads share one aisle, which is the worst case: every
+ * update contends for the same cache line. With -s each thread gets its own
+ * aisle on its own cache line instead, which shows the cost of the atomic
+ * instructions alone.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -pthread -o aisle_atomic_bench aisle_atomic_bench.c \
+ *       aisle_atomic.c aisle_manager.c
+ *
+ * Usage:
+ *   ./aisle_atomic_bench [-n iterations] [-t max_threads] [-s]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aisle_atomic.h"
+#include "aisle_manager.h"
+
+// Maximum number of threads, at most 10 per section so adds never fail
+#define MAX_THREADS 40
+
+// Number of sections in an aisle
+#define NUM_SECTIONS 4
+
+// Aisle updates per iteration of a worker (add, toggle, toggle, remove)
+#define OPS_PER_ITERATION 4
+
+// Every section starts with id (section + 1) and no items
+#define INITIAL_AISLE 0x10000C0008000400UL
+
+enum mode {MODE_PLAIN, MODE_MUTEX, MODE_ATOMIC};
+
+static const char* mode_names[] = {"plain", "mutex", "atomic"};
+
+// One aisle per cache line, so -s measures no false sharing either
+struct padded_aisle {
+  unsigned long aisle;
+  char pad[64 - sizeof(unsigned long)];
+} __attribute__((aligned(64)));
+
+struct bench {
+  enum mode mode;
+  long iterations;
+  int spread;                         // one aisle per thread
+  struct padded_aisle aisles[MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_barrier_t start;
+};
+
+struct worker_arg {
+  struct bench* bench;
+  int thread;
+};
+
+
+static void* worker(void* arg) {
+  struct worker_arg* w = arg;
+  struct bench* b = w->bench;
+  int section = w->thread % NUM_SECTIONS;
+  int space = (w->thread / NUM_SECTIONS) % 10;
+  unsigned long* aisle = &b->aisles[b->spread ? w->thread : 0].aisle;
+
+  pthread_barrier_wait(&b->start);
+  for (long i = 0; i < b->iterations; i++) {
+    switch (b->mode) {
+      case MODE_PLAIN:
+        add_items(aisle, section, 1);
+        toggle_space(aisle, section, space);
+        toggle_space(aisle, section, space);
+        remove_items(aisle, section, 1);
+        break;
+      case MODE_MUTEX:
+        pthread_mutex_lock(&b->lock);
+        add_items(aisle, section, 1);
+        toggle_space(aisle, section, space);
+        toggle_space(aisle, section, space);
+        remove_items(aisle, section, 1);
+        pthread_mutex_unlock(&b->lock);
+        break;
+      case MODE_ATOMIC:
+        atomic_add_items(aisle, section, 1);
+        atomic_toggle_space(aisle, section, space);
+        atomic_toggle_space(aisle, section, space);
+        atomic_remove_items(aisle, section, 1);
+        break;
+    }
+  }
+  return NULL;
+}
+
+
+/*
+ * run - Runs num_threads workers in the given mode. Returns the number of
+ *     seconds taken and sets *ok to whether every aisle ended up unchanged.
+ */
+static double run(struct bench* b, enum mode mode, int num_threads, int* ok) {
+  pthread_t threads[MAX_THREADS];
+  struct worker_arg args[MAX_THREADS];
+  struct timespec start, end;
+  int started = 0;
+
+  b->mode = mode;
+  for (int t = 0; t < MAX_THREADS; t++) {
+    b->aisles[t].aisle = INITIAL_AISLE;
+  }
+  pthread_barrier_init(&b->start, NULL, (unsigned) num_threads + 1);
+  for (int t = 0; t < num_threads; t++) {
+    args[t].bench = b;
+    args[t].thread = t;
+    if (pthread_create(&threads[t], NULL, worker, &args[t]) != 0) {
+      fprintf(stderr, "could not start thread %d\n", t);
+      exit(EXIT_FAILURE);
+    }
+    started++;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pthread_barrier_wait(&b->start);
+  for (int t = 0; t < started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  pthread_barrier_destroy(&b->start);
+
+  *ok = 1;
+  for (int t = 0; t < MAX_THREADS; t++) {
+    *ok &= b->aisles[t].aisle == INITIAL_AISLE;
+  }
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+
+int main(int argc, char* argv[]) {
+  static struct bench b;
+  int max_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  b.iterations = 1000000;
+  while ((opt = getopt(argc, argv, "n:t:sh")) != -1) {
+    switch (opt) {
+      case 'n':
+        b.iterations = atol(optarg);
+        break;
+      case 't':
+        max_threads = atoi(optarg);
+        break;
+      case 's':
+        b.spread = 1;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-n iterations] [-t max_threads] [-s]\n",
+                argv[0]);
+        fprintf(stderr, "\t-s\tgive each thread its own aisle\n");
+        return EXIT_FAILURE;
+    }
+  }
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+  if (max_threads > MAX_THREADS) {
+    max_threads = MAX_THREADS;
+  }
+  pthread_mutex_init(&b.lock, NULL);
+
+  printf("%d iterations of %d updates per thread, %s\n", (int) b.iterations,
+         OPS_PER_ITERATION, b.spread ? "one aisle per thread" : "one shared aisle");
+  printf("%8s %8s %12s %10s %s\n", "threads", "mode", "Mupdates/s",
+         "ns/update", "result");
+  // Powers of two up to max_threads, and max_threads itself
+  for (int n = 1;; n = 2 * n < max_threads ? 2 * n : max_threads) {
+    for (int m = MODE_PLAIN; m <= MODE_ATOMIC; m++) {
+      int ok;
+      double seconds = run(&b, (enum mode) m, n, &ok);
+      double updates = (double) n * b.iterations * OPS_PER_ITERATION;
+      printf("%8d %8s %12.1f %10.2f %s\n", n, mode_names[m],
+             updates / seconds / 1e6, seconds * 1e9 / updates,
+             ok ? "ok" : "LOST UPDATES");
+    }
+    if (n == max_threads) {
+      break;
+    }
+  }
+  pthread_mutex_destroy(&b.lock);
+  return EXIT_SUCCESS;
+}
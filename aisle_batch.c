@@ -0,0 +1,124 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * The aisle_manager.c functions take one aisle and one section per call, so
+ * a bulk restock pays a call, a load and a store for every section it
+ * touches. This file applies many updates at once in two ways:
+ *
+ *   - aisle_apply_ops() takes a list of (aisle, section, operation, argument)
+ *     entries. Each run of entries for the same aisle is applied to a local
+ *     copy of it, which is written back once at the end of the run.
+ *   - The aisles_ functions apply one operation with one argument to the same
+ *     section of a contiguous range of aisles. The per-aisle work is the
+ *     straight-line bit operations of aisle_word.h that aisle_manager.c also
+ *     uses (without pdep), so the loops contain no calls or branches and
+ *     gcc -O3 -mavx2 vectorizes all five, four aisles per register.
+ *
+ * See aisle_manager.c for the aisle layout.
+ */
+
+#include "aisle_batch.h"
+#include "aisle_manager.h"
+#include "aisle_word.h"
+
+// The number of bits in a section
+#define SECTION_SIZE 16
+
+// The number of bits in a section used for the item spaces
+#define NUM_SPACES 10
+
+// Masks for the spaces and the id of a section
+#define SPACES_MASK 0x3FFUL
+#define ID_MASK 0xFC00UL
+
+
+/* Applies one operation to the local copy of its aisle. */
+static void apply_op(unsigned long* aisle, const struct aisle_op* op) {
+  switch (op->kind) {
+    case AISLE_OP_ADD_ITEMS:
+      add_items(aisle, op->section, op->arg);
+      break;
+    case AISLE_OP_REMOVE_ITEMS:
+      remove_items(aisle, op->section, op->arg);
+      break;
+    case AISLE_OP_SET_ID:
+      set_id(aisle, op->section, (unsigned short) op->arg);
+      break;
+    case AISLE_OP_ROTATE_LEFT:
+      rotate_items_left(aisle, op->section, op->arg);
+      break;
+    case AISLE_OP_ROTATE_RIGHT:
+      rotate_items_right(aisle, op->section, op->arg);
+      break;
+  }
+}
+
+void aisle_apply_ops(const struct aisle_op* ops, size_t count) {
+  size_t k = 0;
+
+  while (k < count) {
+    unsigned long* target = ops[k].aisle;
+    unsigned long aisle = *target;
+    for (; k < count && ops[k].aisle == target; k++) {
+      apply_op(&aisle, &ops[k]);
+    }
+    *target = aisle;
+  }
+}
+
+
+void aisles_add_items(unsigned long* aisles, size_t num_aisles, int section,
+                      int n) {
+  int shift = SECTION_SIZE * section;
+  int count = aisle_clamp_items(n);
+
+  for (size_t i = 0; i < num_aisles; i++) {
+    unsigned long empty = ~(aisles[i] >> shift) & SPACES_MASK;
+    aisles[i] |= aisle_lowest_set_bits_loop(empty, count) << shift;
+  }
+}
+
+void aisles_remove_items(unsigned long* aisles, size_t num_aisles, int section,
+                         int n) {
+  int shift = SECTION_SIZE * section;
+  int count = aisle_clamp_items(n);
+
+  for (size_t i = 0; i < num_aisles; i++) {
+    unsigned long full = (aisles[i] >> shift) & SPACES_MASK;
+    aisles[i] &= ~(aisle_lowest_set_bits_loop(full, count) << shift);
+  }
+}
+
+void aisles_set_id(unsigned long* aisles, size_t num_aisles, int section,
+                   unsigned short id) {
+  int shift = SECTION_SIZE * section;
+  unsigned long bits = (unsigned long) id << (shift + NUM_SPACES);
+
+  if (id >> 6) {
+    return;  // set_id leaves the id unchanged for ids wider than 6 bits
+  }
+  for (size_t i = 0; i < num_aisles; i++) {
+    aisles[i] = (aisles[i] & ~(ID_MASK << shift)) | bits;
+  }
+}
+
+void aisles_rotate_left(unsigned long* aisles, size_t num_aisles, int section,
+                        int n) {
+  int shift = SECTION_SIZE * section;
+  int r = aisle_left_rotation(n);
+
+  for (size_t i = 0; i < num_aisles; i++) {
+    unsigned long spaces = (aisles[i] >> shift) & SPACES_MASK;
+    aisles[i] = (aisles[i] & ~(SPACES_MASK << shift)) |
+                (aisle_rotate_spaces(spaces, r) << shift);
+  }
+}
+
+void aisles_rotate_right(unsigned long* aisles, size_t num_aisles, int section,
+                         int n) {
+  // Rotating right by n is rotating left by -n
+  aisles_rotate_left(aisles, num_aisles, section, -(n % NUM_SPACES));
+}
@@ -0,0 +1,50 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Batched versions of the aisle_manager.c updates. See aisle_batch.c for
+ * details.
+ */
+
+#ifndef AISLE_BATCH_H
+#define AISLE_BATCH_H
+
+#include <stddef.h>
+
+enum aisle_op_kind {
+  AISLE_OP_ADD_ITEMS,       // add_items(aisle, section, arg)
+  AISLE_OP_REMOVE_ITEMS,    // remove_items(aisle, section, arg)
+  AISLE_OP_SET_ID,          // set_id(aisle, section, arg)
+  AISLE_OP_ROTATE_LEFT,     // rotate_items_left(aisle, section, arg)
+  AISLE_OP_ROTATE_RIGHT     // rotate_items_right(aisle, section, arg)
+};
+
+struct aisle_op {
+  unsigned long* aisle;
+  int section;
+  enum aisle_op_kind kind;
+  int arg;
+};
+
+/* Applies ops[0..count) in order, with the same result as calling the
+ * aisle_manager.c function of each one in turn. Consecutive operations on
+ * the same aisle read and write it only once, so lists sorted (or grouped)
+ * by aisle cost one load and one store per aisle. */
+void aisle_apply_ops(const struct aisle_op* ops, size_t count);
+
+/* Apply one operation to the same section of every aisle in
+ * aisles[0..num_aisles), with the same result as calling add_items /
+ * remove_items / set_id / rotate_items_left / rotate_items_right on each.
+ * Each aisle is loaded and stored once, and the loops have no calls or
+ * branches so the compiler can vectorize them across aisles. */
+void aisles_add_items(unsigned long* aisles, size_t num_aisles, int section,
+                      int n);
+void aisles_remove_items(unsigned long* aisles, size_t num_aisles, int section,
+                         int n);
+void aisles_set_id(unsigned long* aisles, size_t num_aisles, int section,
+                   unsigned short id);
+void aisles_rotate_left(unsigned long* aisles, size_t num_aisles, int section,
+                        int n);
+void aisles_rotate_right(unsigned long* aisles, size_t num_aisles, int section,
+                         int n);
+
+#endif
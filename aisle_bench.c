@@ -0,0 +1,310 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Checks and times the branch-free aisle_manager.c primitives against the
+ * loop-based versions they replaced, which are kept below with an old_
+ * prefix.
+ *
+ * The check runs num_items, add_items, remove_items and both rotates on
+ * every possible 16-bit section, in every section index of an aisle whose
+ * other sections hold random bits, with every n from 0 to 12 (add/remove) or
+ * 1 to 29 (rotates), and compares the whole resulting aisle. The old rotates
+ * shift by -1 when n is a multiple of 10, which is undefined, so for those n
+ * the new rotates are checked against leaving the aisle unchanged instead.
+ *
+ * The timing runs each version over an array of random aisles and reports
+ * nanoseconds per call.
+ *
+ * The aisle64 rows do the same for the aisle64 layout of aisle_layout.h,
+ * with aisle_manager.c as the old version, including negative n. Without
+ * -mbmi2 the layout's add_items / remove_items use a plain loop over the
+ * spaces and are slower than aisle_manager.c's.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -o aisle_bench aisle_bench.c aisle_manager.c
+ *   (add -mbmi2 to time the pdep versions of add_items / remove_items)
+ *
+ * Usage:
+ *   ./aisle_bench [-n calls]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aisle_layout.h"
+#include "aisle_manager.h"
+
+// Number of aisles the timing loops run over (fits in L1)
+#define NUM_AISLES 1024
+
+// Number of sections in an aisle
+#define NUM_SECTIONS 4
+
+#define SPACES_MASK 0x3FF
+#define MSB1 0x8000
+
+
+/* The loop-based versions, as they were before the rewrite. old_get_spaces
+ * shifts the section down instead of reading it through a short pointer,
+ * which is the strict-aliasing fix and not part of what is compared. */
+
+static unsigned short old_get_spaces(unsigned long* aisle, int index) {
+  return (unsigned short)(*aisle >> (16 * index)) & SPACES_MASK;
+}
+
+static void old_set_spaces(unsigned long* aisle, int index,
+                           unsigned short new_spaces) {
+  if (!((new_spaces >> 10) > 0)) {
+    *aisle = *aisle & (~(((unsigned long) SPACES_MASK) << (16 * index)));
+    *aisle = *aisle | ((unsigned long) new_spaces) << (16 * index);
+  }
+}
+
+static void old_toggle_space(unsigned long* aisle, int index, int space_index) {
+  *aisle = *aisle ^ (((unsigned long) 0x1) << (16 * index + space_index));
+}
+
+static unsigned short old_num_items(unsigned long* aisle, int index) {
+  unsigned short spaces = old_get_spaces(aisle, index);
+  int counter = 0;
+  for (int i = 0; i < 10; i++) {
+    if ((spaces & 0x1) == 1) {
+      counter++;
+    }
+    spaces = spaces >> 1;
+  }
+  return (unsigned short) counter;
+}
+
+static void old_add_items(unsigned long* aisle, int index, int n) {
+  if (n >= 10 - old_num_items(aisle, index)) {
+    old_set_spaces(aisle, index, SPACES_MASK);
+  }
+  unsigned short spaces = old_get_spaces(aisle, index);
+  int counter = 0;
+  for (int i = 0; i < 10; i++) {
+    if (counter == n) {
+      break;
+    }
+    if ((spaces & (unsigned short) 0x1) == 0) {
+      old_toggle_space(aisle, index, i);
+      counter++;
+    }
+    spaces = spaces >> 1;
+  }
+}
+
+static void old_remove_items(unsigned long* aisle, int index, int n) {
+  if (n >= 10 - old_num_items(aisle, index)) {
+    old_set_spaces(aisle, index, ~SPACES_MASK);
+  }
+  unsigned short spaces = old_get_spaces(aisle, index);
+  int counter = 0;
+  for (int i = 0; i < 10; i++) {
+    if (counter == n) {
+      break;
+    }
+    if ((spaces & (unsigned short) 0x1) == 1) {
+      old_toggle_space(aisle, index, i);
+      counter++;
+    }
+    spaces = spaces >> 1;
+  }
+}
+
+static void old_rotate_items_left(unsigned long* aisle, int index, int n) {
+  int num_shifts = n - ((n / 10) * 10);
+  unsigned short spaces = old_get_spaces(aisle, index);
+  unsigned short mask = (unsigned short)(((short) MSB1) >> (num_shifts - 1));
+  unsigned short left_most_space_bits = spaces & (mask >> 6);
+  unsigned short extracted_mask = (left_most_space_bits >> (10 - num_shifts));
+  unsigned new_spaces = ((spaces << num_shifts) & SPACES_MASK) | extracted_mask;
+  old_set_spaces(aisle, index, new_spaces);
+}
+
+static void old_rotate_items_right(unsigned long* aisle, int index, int n) {
+  int num_shifts = n - ((n / 10) * 10);
+  unsigned short spaces = old_get_spaces(aisle, index);
+  unsigned short mask = (unsigned short)(((short) MSB1) >> (num_shifts - 1));
+  unsigned short right_most_space_bits = spaces & (mask >> (6 + (10 - num_shifts)));
+  unsigned short extracted_mask = (right_most_space_bits << (10 - num_shifts));
+  unsigned new_spaces = ((spaces >> num_shifts) & SPACES_MASK) | extracted_mask;
+  old_set_spaces(aisle, index, new_spaces);
+}
+
+
+typedef void (*update_fn)(unsigned long* aisle, int index, int n);
+
+struct op {
+  const char* name;
+  update_fn old_fn;
+  update_fn new_fn;
+  int min_n;
+  int max_n;
+};
+
+/* num_items as an update, so every operation can share one loop: the count
+ * replaces the aisle's low bits. */
+static void count_old(unsigned long* aisle, int index, int n) {
+  (void) n;
+  *aisle = (*aisle & ~0xFUL) | old_num_items(aisle, index);
+}
+
+static void count_new(unsigned long* aisle, int index, int n) {
+  (void) n;
+  *aisle = (*aisle & ~0xFUL) | num_items(aisle, index);
+}
+
+/* The aisle64 layout's versions, with aisle_manager.c's signatures. */
+static void layout_count(unsigned long* aisle, int index, int n) {
+  uint64_t word = *aisle;
+  (void) n;
+  *aisle = (*aisle & ~0xFUL) | (unsigned long) aisle64_num_items(&word, index);
+}
+
+static void layout_add_items(unsigned long* aisle, int index, int n) {
+  uint64_t word = *aisle;
+  aisle64_add_items(&word, index, n);
+  *aisle = word;
+}
+
+static void layout_remove_items(unsigned long* aisle, int index, int n) {
+  uint64_t word = *aisle;
+  aisle64_remove_items(&word, index, n);
+  *aisle = word;
+}
+
+static void layout_rotate_left(unsigned long* aisle, int index, int n) {
+  uint64_t word = *aisle;
+  aisle64_rotate_items_left(&word, index, n);
+  *aisle = word;
+}
+
+static void layout_rotate_right(unsigned long* aisle, int index, int n) {
+  uint64_t word = *aisle;
+  aisle64_rotate_items_right(&word, index, n);
+  *aisle = word;
+}
+
+// n starts at 0 for add_items / remove_items: for n < 0 the old loops never
+// see counter == n and fill or empty the whole section, while the new ones
+// change nothing. For n == 0 both change nothing.
+static const struct op ops[] = {
+  {"num_items", count_old, count_new, 0, 0},
+  {"add_items", old_add_items, add_items, 0, 12},
+  {"remove_items", old_remove_items, remove_items, 0, 12},
+  {"rotate_items_left", old_rotate_items_left, rotate_items_left, 1, 29},
+  {"rotate_items_right", old_rotate_items_right, rotate_items_right, 1, 29},
+  {"aisle64 num_items", count_new, layout_count, 0, 0},
+  {"aisle64 add_items", add_items, layout_add_items, -3, 12},
+  {"aisle64 remove_items", remove_items, layout_remove_items, -3, 12},
+  {"aisle64 rotate_left", rotate_items_left, layout_rotate_left, -29, 29},
+  {"aisle64 rotate_right", rotate_items_right, layout_rotate_right, -29, 29},
+};
+
+#define NUM_OPS ((int)(sizeof(ops) / sizeof(ops[0])))
+
+
+static unsigned long random_aisle(void) {
+  return ((unsigned long) rand() << 40) ^ ((unsigned long) rand() << 20) ^
+         (unsigned long) rand();
+}
+
+/*
+ * check - Compares the old and new version of op on every section value,
+ *     section index and n. Returns the number of mismatches.
+ */
+static long check(const struct op* op) {
+  long mismatches = 0;
+
+  for (unsigned section = 0; section <= 0xFFFF; section++) {
+    for (int index = 0; index < NUM_SECTIONS; index++) {
+      unsigned long base = (random_aisle() & ~(0xFFFFUL << (16 * index))) |
+                           ((unsigned long) section << (16 * index));
+      for (int n = op->min_n; n <= op->max_n; n++) {
+        unsigned long expected = base;
+        unsigned long actual = base;
+        if (op->old_fn == old_rotate_items_left ||
+            op->old_fn == old_rotate_items_right) {
+          if (n % 10 != 0) {
+            op->old_fn(&expected, index, n);
+          }
+        } else {
+          op->old_fn(&expected, index, n);
+        }
+        op->new_fn(&actual, index, n);
+        if (expected != actual) {
+          if (mismatches == 0) {
+            printf("  %s(0x%016lx, %d, %d): expected 0x%016lx, got 0x%016lx\n",
+                   op->name, base, index, n, expected, actual);
+          }
+          mismatches++;
+        }
+      }
+    }
+  }
+  return mismatches;
+}
+
+/* Returns the nanoseconds per call of fn over aisles, calls times. */
+static double time_fn(update_fn fn, unsigned long* aisles, long calls,
+                      const struct op* op) {
+  struct timespec start, end;
+  int range = op->max_n - op->min_n + 1;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long c = 0; c < calls; c++) {
+    fn(&aisles[c % NUM_AISLES], (int)(c % NUM_SECTIONS),
+       op->min_n + (int)(c % range));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) /
+         (double) calls;
+}
+
+
+int main(int argc, char* argv[]) {
+  static unsigned long aisles[NUM_AISLES];
+  long calls = 20000000;
+  long failures = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        calls = atol(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-n calls]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  srand(351);
+
+  printf("%-20s %12s %10s %10s %8s\n", "function", "mismatches", "old ns",
+         "new ns", "speedup");
+  for (int k = 0; k < NUM_OPS; k++) {
+    const struct op* op = &ops[k];
+    long mismatches = check(op);
+    double old_ns, new_ns;
+
+    for (int i = 0; i < NUM_AISLES; i++) {
+      aisles[i] = random_aisle();
+    }
+    old_ns = time_fn(op->old_fn, aisles, calls, op);
+    for (int i = 0; i < NUM_AISLES; i++) {
+      aisles[i] = random_aisle();
+    }
+    new_ns = time_fn(op->new_fn, aisles, calls, op);
+    printf("%-20s %12ld %10.2f %10.2f %7.2fx\n", op->name, mismatches, old_ns,
+           new_ns, old_ns / new_ns);
+    failures += mismatches;
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,178 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Aisle layouts other than the 4 x (6-bit id + 10 spaces) one of
+ * aisle_manager.c, generated at compile time.
+ *
+ * AISLE_LAYOUT_DEFINE(name, word_t, id_bits, num_spaces) defines the type
+ * name_t (one aisle, held in the unsigned integer type word_t) and the
+ * aisle_manager.c operations for it as name_get_section, name_get_spaces,
+ * name_get_id, name_set_section, name_set_spaces, name_set_id,
+ * name_toggle_space, name_num_items, name_add_items, name_remove_items,
+ * name_rotate_items_left and name_rotate_items_right, with the same
+ * semantics. A section is num_spaces spaces bits with id_bits id bits above
+ * them, and an aisle is as many sections as fit in word_t, section 0 lowest.
+ * Sections can be up to 32 bits long.
+ *
+ * The section size, count and masks are constant expressions of the macro
+ * arguments, and every function is static inline, so each layout compiles to
+ * the same shifts and masks as a hand-written version of it.
+ *
+ * No store uses these layouts yet: aisle64 is the aisle_manager.c layout,
+ * and the others show wider ids, sections or aisles. store_harness.c fuzzes
+ * all of them against its reference model and aisle_bench.c times aisle64
+ * against aisle_manager.c. Others can be defined the same way where they are
+ * needed.
+ */
+
+#ifndef AISLE_LAYOUT_H
+#define AISLE_LAYOUT_H
+
+#include <stdint.h>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+/* Returns the lowest min(n, popcount(mask)) set bits of mask, for
+ * 0 <= n <= num_bits <= 32. See lowest_set_bits in aisle_manager.c. */
+static inline uint32_t aisle_layout_lowest_bits(uint32_t mask, int n,
+                                                int num_bits) {
+#ifdef __BMI2__
+  (void) num_bits;
+  return _pdep_u32((uint32_t) ((1ULL << n) - 1), mask);
+#else
+  uint32_t kept = 0;
+  uint32_t rank = 0;
+  for (int i = 0; i < num_bits; i++) {
+    uint32_t take = ((mask >> i) & 1) & (rank < (uint32_t) n);
+    kept |= take << i;
+    rank += take;
+  }
+  return kept;
+#endif
+}
+
+#define AISLE_LAYOUT_DEFINE(name, word_t, id_bits, num_spaces)                \
+  typedef word_t name##_t;                                                    \
+                                                                              \
+  enum {                                                                      \
+    name##_ID_SIZE = (id_bits),                                               \
+    name##_NUM_SPACES = (num_spaces),                                         \
+    name##_SECTION_SIZE = (id_bits) + (num_spaces),                           \
+    name##_NUM_SECTIONS = (int) (sizeof(word_t) * 8) / ((id_bits) + (num_spaces)) \
+  };                                                                          \
+                                                                              \
+  typedef char name##_fits[((id_bits) + (num_spaces) <= 32 &&                 \
+                            (id_bits) > 0 && (num_spaces) > 0) ? 1 : -1];     \
+                                                                              \
+  static inline uint32_t name##_section_mask(void) {                          \
+    return (uint32_t) ((1ULL << name##_SECTION_SIZE) - 1);                    \
+  }                                                                           \
+                                                                              \
+  static inline uint32_t name##_spaces_mask(void) {                           \
+    return (uint32_t) ((1ULL << (num_spaces)) - 1);                           \
+  }                                                                           \
+                                                                              \
+  static inline uint32_t name##_get_section(const word_t* aisle, int index) { \
+    return (uint32_t) (*aisle >> (name##_SECTION_SIZE * index)) &             \
+           name##_section_mask();                                             \
+  }                                                                           \
+                                                                              \
+  static inline uint32_t name##_get_spaces(const word_t* aisle, int index) {  \
+    return name##_get_section(aisle, index) & name##_spaces_mask();           \
+  }                                                                           \
+                                                                              \
+  static inline uint32_t name##_get_id(const word_t* aisle, int index) {      \
+    return name##_get_section(aisle, index) >> (num_spaces);                  \
+  }                                                                           \
+                                                                              \
+  /* Replaces the bits of mask (in section 0's position) of a section */      \
+  static inline void name##_put(word_t* aisle, int index, uint32_t mask,      \
+                                uint32_t bits) {                              \
+    int shift = name##_SECTION_SIZE * index;                                  \
+    *aisle = (*aisle & ~((word_t) mask << shift)) | ((word_t) bits << shift); \
+  }                                                                           \
+                                                                              \
+  static inline void name##_set_section(word_t* aisle, int index,             \
+                                        uint32_t new_section) {               \
+    name##_put(aisle, index, name##_section_mask(),                           \
+               new_section & name##_section_mask());                          \
+  }                                                                           \
+                                                                              \
+  static inline void name##_set_spaces(word_t* aisle, int index,              \
+                                       uint32_t new_spaces) {                 \
+    if ((new_spaces & ~name##_spaces_mask()) == 0) {                          \
+      name##_put(aisle, index, name##_spaces_mask(), new_spaces);             \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  static inline void name##_set_id(word_t* aisle, int index,                  \
+                                   uint32_t new_id) {                         \
+    if ((new_id >> (id_bits)) == 0) {                                         \
+      name##_put(aisle, index,                                                \
+                 name##_section_mask() & ~name##_spaces_mask(),               \
+                 new_id << (num_spaces));                                     \
+    }                                                                         \
+  }                                                                           \
+                                                                              \
+  static inline void name##_toggle_space(word_t* aisle, int index,            \
+                                         int space_index) {                   \
+    *aisle ^= (word_t) 1 << (name##_SECTION_SIZE * index + space_index);      \
+  }                                                                           \
+                                                                              \
+  static inline int name##_num_items(const word_t* aisle, int index) {        \
+    return __builtin_popcount(name##_get_spaces(aisle, index));               \
+  }                                                                           \
+                                                                              \
+  static inline int name##_clamp_items(int n) {                               \
+    n = n < 0 ? 0 : n;                                                        \
+    return n > (num_spaces) ? (num_spaces) : n;                               \
+  }                                                                           \
+                                                                              \
+  static inline void name##_add_items(word_t* aisle, int index, int n) {      \
+    uint32_t empty = ~name##_get_spaces(aisle, index) & name##_spaces_mask(); \
+    *aisle |= (word_t) aisle_layout_lowest_bits(empty, name##_clamp_items(n), \
+                                                (num_spaces))                 \
+              << (name##_SECTION_SIZE * index);                               \
+  }                                                                           \
+                                                                              \
+  static inline void name##_remove_items(word_t* aisle, int index, int n) {   \
+    uint32_t spaces = name##_get_spaces(aisle, index);                        \
+    *aisle &= ~((word_t) aisle_layout_lowest_bits(spaces,                     \
+                                                  name##_clamp_items(n),      \
+                                                  (num_spaces))               \
+                << (name##_SECTION_SIZE * index));                            \
+  }                                                                           \
+                                                                              \
+  /* Rotates the spaces left by n slots, n of either sign */                  \
+  static inline void name##_rotate_items_left(word_t* aisle, int index,       \
+                                              int n) {                        \
+    int r = n % (num_spaces);                                                 \
+    uint64_t spaces = name##_get_spaces(aisle, index);                        \
+    r = r < 0 ? r + (num_spaces) : r;                                         \
+    spaces = (spaces << r) | (spaces >> ((num_spaces) - r));                  \
+    name##_put(aisle, index, name##_spaces_mask(),                            \
+               (uint32_t) spaces & name##_spaces_mask());                     \
+  }                                                                           \
+                                                                              \
+  static inline void name##_rotate_items_right(word_t* aisle, int index,      \
+                                               int n) {                       \
+    name##_rotate_items_left(aisle, index, -(n % (num_spaces)));              \
+  }
+
+// The aisle_manager.c layout: 4 sections of a 6-bit id and 10 spaces
+AISLE_LAYOUT_DEFINE(aisle64, uint64_t, 6, 10)
+
+// 2 sections of an 8-bit id and 24 spaces, for 256 ids and bigger sections
+AISLE_LAYOUT_DEFINE(aisle32x2, uint64_t, 8, 24)
+
+#ifdef __SIZEOF_INT128__
+// 8 sections of a 6-bit id and 10 spaces: twice the sections per aisle
+AISLE_LAYOUT_DEFINE(aisle128, unsigned __int128, 6, 10)
+
+// 4 sections of an 8-bit id and 24 spaces in 128 bits
+AISLE_LAYOUT_DEFINE(aisle128x4, unsigned __int128, 8, 24)
+#endif
+
+#endif
@@ -50,10 +50,14 @@
  *      items stored in the section (at bit offsets 8, 4, 3, and 1) and 6
  *      vacant spaces.
  *
+ *    aisle_layout.h generates the same operations for other section sizes
+ *    and aisle widths.
+ *
  *  Written by Porter Jones (pbjones@cs.washington.edu)
  */
 
 #include "aisle_manager.h"
+#include "aisle_word.h"
 #include "store_util.h"
 
 // the number of total bits in a section
@@ -88,8 +92,6 @@
 // non-id bits to 0.
 #define ID_MASK 0xFC00
 
-#define MSB1 0x8000
-
 
 /* Given a pointer to an aisle and a section index, return the section at the
  * given index of the given aisle.
@@ -97,11 +99,10 @@
  * Can assume the index is a valid index (0-3 inclusive).
  */
 unsigned short get_section(unsigned long* aisle, int index) {
-  // TODO: implement this method
-  // We need to cast aisle as a short because aisles are longs while sections are supposed to be shorts
-  // "1 * index" figures out how many "short pointers" to add. We deference this line to get the value to put it into a short to return that
-  unsigned short s =  *((short*) aisle + (1 * index));
-  return s;
+  // Shift the section down instead of reading the aisle through a short
+  // pointer, which breaks strict aliasing and lets the compiler return a stale
+  // section right after a write to *aisle (seen at -O2)
+  return (unsigned short) (*aisle >> (SECTION_SIZE * index));
 }
 
 /* Given a pointer to an aisle and a section index, return the spaces of the
@@ -211,16 +212,8 @@ void toggle_space(unsigned long* aisle, int index, int space_index) {
  * Can assume the index is a valid index (0-3 inclusive).
  */
 unsigned short num_items(unsigned long* aisle, int index) {
-  // TODO: implement this method
-  unsigned short spaces = get_spaces(aisle, index);
-  int counter = 0;//going through one section
-  for(int i = 0; i < 10; i++){
-       if( (spaces & 0x1) == 1){//if the bit on the right side &'s to 1 its 1 and there is an item there
-	       counter++;
-       }
-       spaces = spaces >> 1;//move to next
-  }
-  return (unsigned short) counter;
+  // Every set spaces bit is one item
+  return (unsigned short) __builtin_popcount(get_spaces(aisle, index));
 }
 
 /* Given a pointer to an aisle, a section index, and the desired number of
@@ -233,22 +226,12 @@ unsigned short num_items(unsigned long* aisle, int index) {
  * Can assume the index is a valid index (0-3 inclusive).
  */
 void add_items(unsigned long* aisle, int index, int n) {
-  // TODO: implement this method
-      if( n >= 10 - num_items(aisle, index)){
-            set_spaces(aisle, index, SPACES_MASK);
-      }//If it just goes over everything should automatically be full
-      unsigned short spaces = get_spaces(aisle, index);
-      int counter = 0;
-      for(int i = 0; i < 10; i++){
-	 if(counter == n){//if we have added everything we needed
-                 break;
-         }
-         if( (spaces & (unsigned short) 0x1) == 0){//if there is an empty space where we want to add
-               toggle_space(aisle, index, i);
-	       counter++;
-         } 
-         spaces = spaces >> 1;//similar to above, move to next
-      }
+  // The spaces to fill are the lowest n empty ones, all of them if n is at
+  // least the number of empty spaces; n <= 0 adds nothing
+  unsigned spaces = get_spaces(aisle, index);
+  unsigned empty = ~spaces & SPACES_MASK;
+  *aisle |= aisle_lowest_set_bits(empty, aisle_clamp_items(n))
+            << (SECTION_SIZE * index);
 }
 
 /* Given a pointer to an aisle, a section index, and the desired number of
@@ -261,22 +244,11 @@ void add_items(unsigned long* aisle, int index, int n) {
  * Can assume the index is a valid index (0-3 inclusive).
  */
 void remove_items(unsigned long* aisle, int index, int n) {
-  // TODO: implement this method
-    if( n >= 10 - num_items(aisle, index)){
-            set_spaces(aisle, index, ~SPACES_MASK);//remove everything
-      }
-      unsigned short spaces = get_spaces(aisle, index);
-      int counter = 0;
-      for(int i = 0; i < 10; i++){
-         if(counter == n){
-                 break;
-         }
-         if( (spaces & (unsigned short) 0x1) == 1){//just opposite of above
-               toggle_space(aisle, index, i);
-               counter++;
-         }
-         spaces = spaces >> 1;
-      }
+  // The items to take are the lowest n ones, all of them if n is at least the
+  // number of items; n <= 0 removes nothing
+  unsigned spaces = get_spaces(aisle, index);
+  *aisle &= ~(aisle_lowest_set_bits(spaces, aisle_clamp_items(n))
+              << (SECTION_SIZE * index));
 }
 
 /* Given a pointer to an aisle, a section index, and a number of slots to
@@ -290,21 +262,8 @@ void remove_items(unsigned long* aisle, int index, int n) {
  * Can NOT assume n < NUM_SPACES (hint: find an equivalent rotation).
  */
 void rotate_items_left(unsigned long* aisle, int index, int n) {
-  // TODO: implement this method
-  // keep num_shifts/n below 10
-  int num_shifts = n - ((n/10)*10);
-  unsigned short spaces = get_spaces(aisle, index);
-  //create a mask with n 1s in the Most Signifcant Bits using arithmetic shifting
-  unsigned short mask = (unsigned short)(((short)MSB1) >> (num_shifts - 1));
-  //shift the 1s  to the n left-most spaces bits
-  //then & that with spaces so you can extract the n left-most space bits into left_most_space_bits
-  unsigned short left_most_space_bits = spaces & (mask >> 6);
-  //shift these extrcted bits to the least signifcant bits
-  unsigned short extracted_mask = (left_most_space_bits >> (10-num_shifts));
-  //shift spaces by n and or with extracted_mask to replace extra 0s that were created - effectively looping the spaces
-  unsigned new_spaces = ((spaces << num_shifts) & SPACES_MASK) | extracted_mask;
-  //set new_spaces to aisle
-  set_spaces(aisle, index, new_spaces);
+  unsigned spaces = get_spaces(aisle, index);
+  set_spaces(aisle, index, aisle_rotate_spaces(spaces, aisle_left_rotation(n)));
 }
 
 /* Given a pointer to an aisle, a section index, and a number of slots to
@@ -318,18 +277,8 @@ void rotate_items_left(unsigned long* aisle, int index, int n) {
  * Can NOT assume n < NUM_SPACES (hint: find an equivalent rotation).
  */
 void rotate_items_right(unsigned long* aisle, int index, int n) {
-  // TODO: implement this method
-  int num_shifts = n - ((n/10)*10);
-  unsigned short spaces = get_spaces(aisle, index);
-  //create a mask with n 1s in the Most Signifcant Bits using arithmetic shifting
-  unsigned short mask = (unsigned short)(((short)MSB1) >> (num_shifts - 1));
-  //shift the 1s  to the n left-most spaces bits
-  //then & that with spaces so you can extract the n right-most space bits into right_most_space_bits
-  unsigned short right_most_space_bits = spaces & (mask >> (6 + (10 - num_shifts)) );
-  //shift these extracted bits to the least signifcant bits
-  unsigned short extracted_mask = (right_most_space_bits << (10 - num_shifts));
-  //shift spaces by n and or with extracted_mask to replace extra 0s that were created - effectively looping the spaces
-  unsigned new_spaces = ((spaces >> num_shifts) & SPACES_MASK) | extracted_mask;
-  //set new_spaces to aisle
-  set_spaces(aisle, index, new_spaces);
+  // Rotating right by n is rotating left by -n
+  unsigned spaces = get_spaces(aisle, index);
+  set_spaces(aisle, index,
+             aisle_rotate_spaces(spaces, aisle_left_rotation(-(n % NUM_SPACES))));
 }
@@ -0,0 +1,147 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Whole-aisle operations: each helper below looks at or changes all four
+ * sections of an aisle at once, as the four 16-bit lanes of the 64-bit word
+ * (SWAR, "SIMD within a register"), so code that handles every section of an
+ * aisle loads it once and stores it once. Results that have one value per
+ * section come back the same way, with section j in bits 16j..16j+15; use
+ * aisle_lane() to read one. See aisle_manager.c for the aisle layout.
+ */
+
+#ifndef AISLE_WORD_H
+#define AISLE_WORD_H
+
+#include <stdint.h>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// Number of sections (16-bit lanes) in an aisle
+#define AISLE_SECTIONS 4
+
+// Most items a section can hold
+#define AISLE_MAX_ITEMS 10
+
+// The spaces bits of all four sections of an aisle
+#define AISLE_LANE_SPACES 0x03FF03FF03FF03FFUL
+
+// The low bit and high bit of every 16-bit lane
+#define AISLE_LANE_LOW 0x0001000100010001UL
+#define AISLE_LANE_HIGH 0x8000800080008000UL
+
+// Lets the compiler fully unroll the fixed 10-step loops below
+#if defined(__GNUC__) && !defined(__clang__)
+#define AISLE_UNROLL_SPACES _Pragma("GCC unroll 10")
+#else
+#define AISLE_UNROLL_SPACES
+#endif
+
+/* Returns lane j of a per-section result. */
+static inline int aisle_lane(uint64_t lanes, int j) {
+  return (int)((lanes >> (16 * j)) & 0xFFFF);
+}
+
+/* Returns the id of every section of aisle, one per lane. */
+static inline uint64_t aisle_ids(uint64_t aisle) {
+  return (aisle >> 10) & (0x3FUL * AISLE_LANE_LOW);
+}
+
+/* Returns the number of items in every section of aisle, one per lane. */
+static inline uint64_t aisle_counts(uint64_t aisle) {
+  uint64_t v = aisle & AISLE_LANE_SPACES;
+  v = v - ((v >> 1) & 0x5555555555555555UL);
+  v = (v & 0x3333333333333333UL) + ((v >> 2) & 0x3333333333333333UL);
+  v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FUL;
+  return (v + (v >> 8)) & 0x00FF00FF00FF00FFUL;
+}
+
+/* Returns the number of empty spaces in every section of aisle, one per
+ * lane. */
+static inline uint64_t aisle_room(uint64_t aisle) {
+  return AISLE_MAX_ITEMS * AISLE_LANE_LOW - aisle_counts(aisle);
+}
+
+/* Returns a word whose lane j has its high bit set if lane j of v is zero.
+ * Lanes above a zero lane may be flagged falsely (borrow), so only the lowest
+ * flagged lane is meaningful. */
+static inline uint64_t aisle_lane_zero(uint64_t v) {
+  return (v - AISLE_LANE_LOW) & ~v & AISLE_LANE_HIGH;
+}
+
+/* Returns the index of the lowest lane flagged in an aisle_lane_zero-style
+ * mask. */
+static inline int aisle_lowest_lane(uint64_t mask) {
+  return __builtin_ctzll(mask) / 16;
+}
+
+/* Clamps an item count to 0..AISLE_MAX_ITEMS. */
+static inline int aisle_clamp_items(int n) {
+  n = n < 0 ? 0 : n;
+  return n > AISLE_MAX_ITEMS ? AISLE_MAX_ITEMS : n;
+}
+
+/* Returns the lowest min(n, popcount(mask)) set bits of the 10-bit spaces
+ * mask, for 0 <= n <= 10. Each bit is kept while fewer than n bits have been
+ * kept below it, without branches. "Fewer than n" is read off the sign of
+ * rank - n rather than compared, which is what lets gcc vectorize a loop
+ * over many aisles that calls this. */
+static inline uint64_t aisle_lowest_set_bits_loop(uint64_t mask, int n) {
+  uint64_t kept = 0;
+  uint64_t rank = 0;
+  AISLE_UNROLL_SPACES
+  for (int i = 0; i < AISLE_MAX_ITEMS; i++) {
+    uint64_t take = (mask >> i) & ((rank - (uint64_t) n) >> 63);
+    kept |= take << i;
+    rank += take;
+  }
+  return kept;
+}
+
+/* Same as aisle_lowest_set_bits_loop, but one pdep with BMI2: the n low bits
+ * of (1 << n) - 1 are deposited into the set bits of mask, lowest first.
+ * pdep has no vector form, so vectorized loops use the _loop version. */
+static inline uint64_t aisle_lowest_set_bits(uint64_t mask, int n) {
+#ifdef __BMI2__
+  return _pdep_u32((1u << n) - 1, (uint32_t) mask);
+#else
+  return aisle_lowest_set_bits_loop(mask, n);
+#endif
+}
+
+/* Reduces a rotation amount (of either sign) to the equivalent left rotation
+ * by 0..9 slots. */
+static inline int aisle_left_rotation(int n) {
+  int r = n % AISLE_MAX_ITEMS;
+  return r < 0 ? r + AISLE_MAX_ITEMS : r;
+}
+
+/* Rotates the 10-bit spaces pattern left by 0 <= r < 10 slots. A rotation by
+ * 0 shifts the other half by 10, which moves every spaces bit out. */
+static inline uint64_t aisle_rotate_spaces(uint64_t spaces, int r) {
+  return ((spaces << r) | (spaces >> (AISLE_MAX_ITEMS - r))) & 0x3FFUL;
+}
+
+/*
+ * aisle_fill - Returns aisle with amounts (one count per lane, at most 10
+ *     each) items added to its sections, in the lowest empty spaces like
+ *     add_items. Lanes asking for more items than there is room for come
+ *     back full. Each of the ten rounds fills the lowest empty space of every
+ *     lane that still wants an item: v | (v + 1) sets the lowest zero bit,
+ *     and a full lane's carry lands in bit 10, which the spaces mask drops.
+ */
+static inline uint64_t aisle_fill(uint64_t aisle, uint64_t amounts) {
+  uint64_t spaces = aisle & AISLE_LANE_SPACES;
+
+  for (int round = 0; round < AISLE_MAX_ITEMS; round++) {
+    // 0xFFFF in every lane whose amount is still nonzero
+    uint64_t active = (((amounts + 0x7FFF * AISLE_LANE_LOW) & AISLE_LANE_HIGH) >> 15)
+                      * 0xFFFF;
+    spaces |= (spaces + AISLE_LANE_LOW) & AISLE_LANE_SPACES & active;
+    amounts -= AISLE_LANE_LOW & active;
+  }
+  return (aisle & ~AISLE_LANE_SPACES) | spaces;
+}
+
+#endif
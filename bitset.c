@@ -0,0 +1,114 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * A bitset with summary levels on top: bit j of level k+1 is set exactly when
+ * word j of level k is nonzero, and the top level is a single word. Setting
+ * or clearing a bit, and finding the next set bit after a position, each
+ * touch at most one word per level, so they take O(log64 n) time: four word
+ * accesses cover 16 million bits. The summary levels add about 1/63 to the
+ * memory of the bits themselves.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitset.h"
+
+
+int bitset_init(bitset* b, size_t size) {
+  size_t bits = size;
+
+  b->size = size;
+  b->num_levels = 0;
+  do {
+    size_t words = (bits + 63) / 64;
+    if (b->num_levels == BITSET_MAX_LEVELS) {
+      bitset_free(b);
+      return -1;
+    }
+    b->level_bits[b->num_levels] = bits;
+    b->levels[b->num_levels] = calloc(words > 0 ? words : 1, sizeof(uint64_t));
+    if (b->levels[b->num_levels] == NULL) {
+      bitset_free(b);
+      return -1;
+    }
+    b->num_levels++;
+    bits = words;
+  } while (bits > 1);
+  return 0;
+}
+
+void bitset_free(bitset* b) {
+  for (int k = 0; k < b->num_levels; k++) {
+    free(b->levels[k]);
+    b->levels[k] = NULL;
+  }
+  b->num_levels = 0;
+}
+
+
+void bitset_set(bitset* b, size_t i) {
+  for (int k = 0; k < b->num_levels; k++) {
+    uint64_t* word = &b->levels[k][i / 64];
+    int was_empty = *word == 0;
+    *word |= 1ULL << (i % 64);
+    if (!was_empty) {
+      return;  // the levels above already know this word is nonzero
+    }
+    i /= 64;
+  }
+}
+
+void bitset_clear(bitset* b, size_t i) {
+  for (int k = 0; k < b->num_levels; k++) {
+    uint64_t* word = &b->levels[k][i / 64];
+    *word &= ~(1ULL << (i % 64));
+    if (*word != 0) {
+      return;  // the word is still nonzero, nothing changes above
+    }
+    i /= 64;
+  }
+}
+
+void bitset_set_all(bitset* b) {
+  for (int k = 0; k < b->num_levels; k++) {
+    size_t bits = b->level_bits[k];
+    size_t words = (bits + 63) / 64;
+    memset(b->levels[k], 0xFF, words * sizeof(uint64_t));
+    if (bits % 64 != 0) {
+      b->levels[k][words - 1] = (1ULL << (bits % 64)) - 1;  // no bits past the end
+    }
+  }
+}
+
+
+size_t bitset_next(const bitset* b, size_t i) {
+  int k = 0;
+
+  // Climb until a level has a set bit at or after position i
+  for (;;) {
+    if (i < b->level_bits[k]) {
+      uint64_t word = b->levels[k][i / 64] & (~0ULL << (i % 64));
+      if (word != 0) {
+        i = (i / 64) * 64 + (size_t) __builtin_ctzll(word);
+        break;
+      }
+    }
+    if (k == b->num_levels - 1) {
+      return b->size;
+    }
+    // Nothing left in this word, continue from the next word one level up
+    i = i / 64 + 1;
+    k++;
+  }
+
+  // Descend to the first set bit below the word that was found
+  while (k > 0) {
+    k--;
+    i = i * 64 + (size_t) __builtin_ctzll(b->levels[k][i]);
+  }
+  return i;
+}
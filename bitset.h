@@ -0,0 +1,51 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Hierarchical bitset used by the store's indexes. See bitset.c for details.
+ */
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most levels a bitset can have; 64^6 bits is far more than any store needs
+#define BITSET_MAX_LEVELS 6
+
+typedef struct {
+  size_t size;                              // number of bits
+  int num_levels;
+  uint64_t* levels[BITSET_MAX_LEVELS];      // levels[0] holds the bits
+  size_t level_bits[BITSET_MAX_LEVELS];     // bits in use at each level
+} bitset;
+
+/* Initializes b to size cleared bits. Returns 0 on success and -1 if memory
+ * runs out. */
+int bitset_init(bitset* b, size_t size);
+
+/* Frees the memory held by b. */
+void bitset_free(bitset* b);
+
+/* Sets or clears bit i. */
+void bitset_set(bitset* b, size_t i);
+void bitset_clear(bitset* b, size_t i);
+
+/* Sets every bit, in time proportional to the number of words. */
+void bitset_set_all(bitset* b);
+
+/* Returns whether bit i is set. */
+static inline int bitset_test(const bitset* b, size_t i) {
+  return (int)((b->levels[0][i / 64] >> (i % 64)) & 1);
+}
+
+/* Returns the index of the first set bit at or after i, or b->size if there
+ * is none. */
+size_t bitset_next(const bitset* b, size_t i);
+
+/* Returns whether any bit is set. */
+static inline int bitset_any(const bitset* b) {
+  return b->levels[b->num_levels - 1][0] != 0;
+}
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Fast Cache Geometry Prober
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Same questions as get_block_size, get_cache_size and get_cache_assoc in
+ * cache-test-skel.c, answered with far fewer calls to access_cache().
+ *
+ * The skeleton versions grow their candidate by one block (or one way) at a
+ * time and refill the cache from scratch for every candidate, so the size
+ * probe alone makes about (C/B)^2 / 2 accesses. Here every question is turned
+ * into a monotone yes/no test, and the answer is found by doubling the
+ * candidate until the test fails and then binary searching between the last
+ * success and the first failure:
+ *
+ *   block size: after touching address 0, does address b still hit?
+ *   cache size: after touching blocks 0..n-1 in order, does block 0 still
+ *               hit? (yes exactly when n <= C/B)
+ *   assoc:      after touching 0, C, 2C, ..., (k-1)C (all in set 0), does
+ *               address 0 still hit? (yes exactly when k <= assoc)
+ *
+ * Each test starts from a flushed cache. Because real geometries are powers
+ * of two, the binary search almost always ends after a single extra test, so
+ * the size probe costs about 4 * C/B accesses and the associativity probe
+ * about 4 * assoc.
+ *
+ * Like the skeleton, the tests assume a replacement policy that never evicts
+ * the most recently filled block of a set while older ones remain (LRU,
+ * FIFO, tree-PLRU all qualify).
+ *
+ * Once the geometry is known, the replacement policy is found by filling set
+ * 0 with blocks w0..w(A-1) in order, touching w0 again, and then loading one
+ * more block wA to force an eviction. The victim differs per policy:
+ *
+ *   LRU:       w1 (least recently used, since w0 was just touched)
+ *   FIFO:      w0 (first in, touching it does not matter)
+ *   tree-PLRU: w(A/2) (the touch of w0 points the root at the other half,
+ *              and within that half the bits point away from w(A-1))
+ *   random:    varies from run to run
+ *
+ * Each candidate victim is checked in its own run, since checking a block
+ * by accessing it changes the state of the set. With two ways tree-PLRU and
+ * LRU are the same policy and are reported as LRU.
+ *
+ * The write policy needs a cache that can be written, which the mystery
+ * cache interface cannot do. If the cache under test also provides
+ * write_cache() (the simulator in cache-sim.c does), a write miss
+ * followed by a read of the same address tells whether the write allocated.
+ */
+
+#include <stddef.h>  // To be able to use NULL
+
+#include "cache-probe.h"
+#include "support/mystery-cache.h"
+
+// Optional write access, provided by caches that support it. Resolves to
+// NULL when the cache under test is the read-only mystery cache.
+bool_t write_cache(addr_t address) __attribute__((weak));
+
+// Largest block size, cache size and associativity that will be tried. Keeps
+// the doubling from running away if the cache under test misbehaves.
+#define MAX_PROBE (1 << 30)
+
+// Runs of each replacement experiment per way, and at most. A random policy
+// evicts a given block with probability 1/A, so it gives the same answer in
+// all 16A runs with probability at most (1 - 1/A)^(16A) < e^-16. Past 256
+// ways the cap keeps the probe from growing with A^2, and the bound becomes
+// e^-(4096/A).
+#define POLICY_RUNS_PER_WAY 16
+#define POLICY_MAX_RUNS 4096
+
+// access_cache() calls made by this thread since the last probe_reset_count()
+static __thread unsigned long accesses = 0;
+
+
+/* Counting wrapper around access_cache(). */
+static bool_t probe_access(addr_t address) {
+  accesses++;
+  return access_cache(address);
+}
+
+unsigned long probe_access_count(void) {
+  return accesses;
+}
+
+void probe_reset_count(void) {
+  accesses = 0;
+}
+
+
+/*
+ * search - Given a monotone test that holds for lo and fails for hi, returns
+ *     the largest value in [lo, hi) for which it holds. Tries lo + 1 first,
+ *     which settles the common power-of-two case in one test.
+ */
+static int search(int (*holds)(int, int), int arg, int lo, int hi) {
+  if (lo + 1 < hi && !holds(lo + 1, arg)) {
+    return lo;
+  }
+  while (lo + 1 < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (holds(mid, arg)) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+/* Does address offset still hit after only address 0 was loaded? */
+static int same_block(int offset, int unused) {
+  (void) unused;
+  flush_cache();
+  probe_access(0);
+  return probe_access(offset);
+}
+
+int probe_block_size(void) {
+  int b = 1;
+  while (b < MAX_PROBE && same_block(b, 0)) {
+    b *= 2;
+  }
+  // Offsets below b/2 all hit; b is the first offset past the block
+  return search(same_block, 0, b / 2, b) + 1;
+}
+
+
+/* Does block 0 survive loading n consecutive blocks? */
+static int blocks_fit(int n, int block_size) {
+  flush_cache();
+  for (int i = 0; i < n; i++) {
+    probe_access((addr_t) i * block_size);
+  }
+  return probe_access(0);
+}
+
+int probe_cache_size(int block_size) {
+  int n = 1;
+  while (n < MAX_PROBE / block_size && blocks_fit(2 * n, block_size)) {
+    n *= 2;
+  }
+  return search(blocks_fit, block_size, n, 2 * n) * block_size;
+}
+
+
+/* Does address 0 survive loading k blocks that all map to its set? */
+static int ways_fit(int k, int cache_size) {
+  flush_cache();
+  for (int i = 0; i < k; i++) {
+    probe_access((addr_t) i * cache_size);
+  }
+  return probe_access(0);
+}
+
+int probe_cache_assoc(int block_size, int cache_size) {
+  int max_ways = cache_size / block_size;
+  int k = 1;
+  while (k < max_ways && ways_fit(2 * k, cache_size)) {
+    k *= 2;
+  }
+  if (k >= max_ways) {
+    // Fully associative
+    return max_ways;
+  }
+  return search(ways_fit, cache_size, k, 2 * k);
+}
+
+
+/*
+ * survives_eviction - Fills set 0 with assoc blocks, touches the first one
+ *     again, loads one more block and reports whether block victim (0-based
+ *     fill order) is still cached.
+ */
+static int survives_eviction(int victim, int cache_size, int assoc) {
+  flush_cache();
+  for (int i = 0; i < assoc; i++) {
+    probe_access((addr_t) i * cache_size);
+  }
+  probe_access(0);
+  probe_access((addr_t) assoc * cache_size);
+  return probe_access((addr_t) victim * cache_size);
+}
+
+/*
+ * survival_rate - Runs survives_eviction POLICY_RUNS_PER_WAY times per way
+ *     (at most POLICY_MAX_RUNS). Returns 1 if the block always survived, 0 if
+ *     it never did and -1 as soon as it varied.
+ */
+static int survival_rate(int victim, int cache_size, int assoc) {
+  long runs = (long) POLICY_RUNS_PER_WAY * assoc;
+  int first = survives_eviction(victim, cache_size, assoc) != 0;
+
+  if (runs > POLICY_MAX_RUNS) {
+    runs = POLICY_MAX_RUNS;
+  }
+  for (long run = 1; run < runs; run++) {
+    if ((survives_eviction(victim, cache_size, assoc) != 0) != first) {
+      return -1;
+    }
+  }
+  return first;
+}
+
+enum replacement_policy probe_replacement_policy(int cache_size, int assoc) {
+  int first, second, half;
+
+  if (assoc <= 1) {
+    return POLICY_DIRECT_MAPPED;
+  }
+
+  first = survival_rate(0, cache_size, assoc);
+  second = survival_rate(1, cache_size, assoc);
+  if (first < 0 || second < 0) {
+    return POLICY_RANDOM;
+  }
+  if (!first && second) {
+    return POLICY_FIFO;
+  }
+  if (first && !second) {
+    return POLICY_LRU;
+  }
+  if (first && second && assoc >= 4) {
+    half = survival_rate(assoc / 2, cache_size, assoc);
+    if (half < 0) {
+      return POLICY_RANDOM;
+    }
+    if (!half) {
+      return POLICY_TREE_PLRU;
+    }
+  }
+  return POLICY_UNKNOWN;
+}
+
+
+enum write_policy probe_write_policy(void) {
+  if (write_cache == NULL) {
+    return WRITE_POLICY_UNKNOWN;
+  }
+  flush_cache();
+  accesses++;
+  write_cache(0);
+  return probe_access(0) ? WRITE_ALLOCATE : NO_WRITE_ALLOCATE;
+}
+
+
+const char* replacement_policy_name(enum replacement_policy policy) {
+  switch (policy) {
+    case POLICY_DIRECT_MAPPED: return "none (direct-mapped)";
+    case POLICY_LRU:           return "LRU";
+    case POLICY_TREE_PLRU:     return "tree-PLRU";
+    case POLICY_FIFO:          return "FIFO";
+    case POLICY_RANDOM:        return "random";
+    default:                   return "unknown";
+  }
+}
+
+const char* write_policy_name(enum write_policy policy) {
+  switch (policy) {
+    case WRITE_ALLOCATE:    return "write-allocate";
+    case NO_WRITE_ALLOCATE: return "no-write-allocate";
+    default:                return "unknown (cache is read-only)";
+  }
+}
@@ -0,0 +1,56 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Fast Cache Geometry Prober
+ *
+ * See cache-probe.c for details.
+ */
+
+#ifndef CACHE_PROBE_H
+#define CACHE_PROBE_H
+
+/* Returns the size (in B) of each block in the cache. */
+int probe_block_size(void);
+
+/* Returns the size (in B) of the cache. */
+int probe_cache_size(int block_size);
+
+/* Returns the associativity of the cache. */
+int probe_cache_assoc(int block_size, int cache_size);
+
+// Replacement policies that probe_replacement_policy() can tell apart
+enum replacement_policy {
+  POLICY_UNKNOWN,
+  POLICY_DIRECT_MAPPED,   // one way, nothing to choose
+  POLICY_LRU,
+  POLICY_TREE_PLRU,
+  POLICY_FIFO,
+  POLICY_RANDOM,
+};
+
+// Write-miss policies that probe_write_policy() can tell apart
+enum write_policy {
+  WRITE_POLICY_UNKNOWN,   // the cache under test has no write_cache()
+  WRITE_ALLOCATE,
+  NO_WRITE_ALLOCATE,
+};
+
+/* Returns the replacement policy of the cache, given its size and
+ * associativity. */
+enum replacement_policy probe_replacement_policy(int cache_size, int assoc);
+
+/* Returns whether a write miss allocates a block in the cache. Needs the
+ * cache under test to provide bool_t write_cache(addr_t address). */
+enum write_policy probe_write_policy(void);
+
+/* Returns a printable name for a policy. */
+const char* replacement_policy_name(enum replacement_policy policy);
+const char* write_policy_name(enum write_policy policy);
+
+/* Returns the number of access_cache() calls made by the probe_ functions
+ * since the last call to probe_reset_count(). */
+unsigned long probe_access_count(void);
+
+/* Resets the access_cache() call counter to 0. */
+void probe_reset_count(void);
+
+#endif
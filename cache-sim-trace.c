@@ -0,0 +1,127 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Trace-Driven Cache Simulation
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Replays a memory trace through the simulator in cache-sim.c and prints hit,
+ * miss and eviction statistics along with the simulation rate.
+ *
+ * Traces are either valgrind lackey output:
+ *   valgrind --tool=lackey --trace-mem=yes --log-file=prog.trace ./prog
+ * or a binary file of little-endian 64-bit addresses with bit 63 set for
+ * writes (-B), which is much faster to parse.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -o cache-sim-trace cache-sim-trace.c cache-sim.c
+ *
+ * Usage:
+ *   ./cache-sim-trace [-s size] [-b block_size] [-a assoc] [-p policy] [-n]
+ *                     [-B] trace_file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cache-sim.h"
+
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-s size] [-b block_size] [-a assoc] [-p policy] "
+                  "[-n] [-B] trace_file\n", prog);
+  fprintf(stderr, "\t-s\tcache size in bytes (default 32768)\n");
+  fprintf(stderr, "\t-b\tblock size in bytes (default 64)\n");
+  fprintf(stderr, "\t-a\tassociativity (default 8)\n");
+  fprintf(stderr, "\t-p\tlru, fifo, plru or random (default lru)\n");
+  fprintf(stderr, "\t-n\tno-write-allocate\n");
+  fprintf(stderr, "\t-B\tbinary trace instead of lackey text\n");
+}
+
+
+int main(int argc, char* argv[]) {
+  struct cache_sim_config config = {32768, 64, 8, SIM_LRU, 1};
+  enum cache_sim_trace_format format = TRACE_LACKEY;
+  const struct cache_sim_stats* stats;
+  struct timespec start, end;
+  long long count;
+  double seconds;
+  cache_sim* sim;
+  FILE* trace;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:b:a:p:nBh")) != -1) {
+    switch (opt) {
+      case 's':
+        config.size = atoi(optarg);
+        break;
+      case 'b':
+        config.block_size = atoi(optarg);
+        break;
+      case 'a':
+        config.assoc = atoi(optarg);
+        break;
+      case 'p':
+        if (cache_sim_parse_policy(optarg, &config.policy) < 0) {
+          fprintf(stderr, "unknown policy \"%s\"\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'n':
+        config.write_allocate = 0;
+        break;
+      case 'B':
+        format = TRACE_BINARY;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  sim = cache_sim_create(&config);
+  if (sim == NULL) {
+    fprintf(stderr, "invalid cache configuration\n");
+    return EXIT_FAILURE;
+  }
+  trace = fopen(argv[optind], format == TRACE_BINARY ? "rb" : "r");
+  if (trace == NULL) {
+    perror(argv[optind]);
+    cache_sim_destroy(sim);
+    return EXIT_FAILURE;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  count = cache_sim_run_trace(sim, trace, format);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fclose(trace);
+  if (count < 0) {
+    fprintf(stderr, "%s: malformed or unreadable trace\n", argv[optind]);
+    cache_sim_destroy(sim);
+    return EXIT_FAILURE;
+  }
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+  stats = cache_sim_get_stats(sim);
+  printf("accesses:  %llu (%llu reads, %llu writes)\n",
+         stats->reads + stats->writes, stats->reads, stats->writes);
+  printf("hits:      %llu\n", stats->hits);
+  printf("misses:    %llu\n", stats->misses);
+  printf("evictions: %llu\n", stats->evictions);
+  if (stats->reads + stats->writes > 0) {
+    printf("miss rate: %.2f%%\n",
+           100.0 * stats->misses / (stats->reads + stats->writes));
+  }
+  if (seconds > 0) {
+    printf("rate:      %.1f M trace records/s\n", count / seconds / 1e6);
+  }
+
+  cache_sim_destroy(sim);
+  return EXIT_SUCCESS;
+}
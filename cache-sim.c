@@ -0,0 +1,451 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Open Cache Simulator
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * A set-associative cache simulator with a configurable number of sets, ways,
+ * block size, replacement policy and write-miss policy. It can be used in two
+ * ways:
+ *
+ *   - Through the cache_sim_* API in cache-sim.h, with any number of
+ *     independent caches, e.g. to replay memory traces recorded with
+ *     valgrind's lackey tool and compare data layouts offline.
+ *
+ *   - As a drop-in replacement for the mystery cache: this file defines
+ *     cache_init(), access_cache() and flush_cache() from
+ *     support/mystery-cache.h (plus write_cache(), which cache-probe.c uses
+ *     to find the write-miss policy), so cache-test and cache-test-fast can
+ *     be linked against it instead of the mystery cache objects. The
+ *     geometry comes from cache_sim_set_default_config() or from the
+ *     CACHE_SIM environment variable, "size:block_size:assoc:policy[:nwa]"
+ *     (e.g. "32768:64:8:plru"); nonzero arguments to cache_init() override
+ *     the size and block size. Each thread has its own current cache, and
+ *     cache_sim_bind() can point it at a cache created through the API.
+ *
+ * State is kept as a structure of arrays so the hot loop touches as little
+ * memory as possible: one array of tags with the ways of a set contiguous
+ * (a lookup scans one or two cache lines), a parallel array of 32-bit
+ * timestamps used only by LRU and FIFO, and one 64-bit word of tree bits per
+ * set used only by tree-PLRU. The tag stored is the whole block address, so
+ * no tag/index split is needed, and the set index is a mask whenever the
+ * number of sets is a power of two.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache-sim.h"
+#include "support/mystery-cache.h"
+
+// Tag of a way that holds no block
+#define INVALID_TAG UINT64_MAX
+
+// Flag marking a write in a binary trace record
+#define TRACE_WRITE_BIT (1ULL << 63)
+
+// Records read from a binary trace at a time
+#define TRACE_CHUNK 8192
+
+// Longest line accepted in a text trace
+#define MAX_LINE 256
+
+struct cache_sim {
+  struct cache_sim_config config;
+  struct cache_sim_stats stats;
+  int block_bits;        // log2(block_size)
+  int ways;
+  uint64_t num_sets;
+  uint64_t set_mask;     // num_sets - 1, only used if sets_pow2
+  int sets_pow2;
+  uint64_t* tags;        // [num_sets][ways] block addresses
+  uint32_t* stamps;      // [num_sets][ways] last use (LRU) or fill (FIFO)
+  uint64_t* plru;        // [num_sets] tree-PLRU bits, heap-indexed from 1
+  uint32_t* ranks;       // [ways] scratch for renumber_stamps
+  uint32_t clock;        // source of stamps
+  uint64_t rng;          // xorshift state for SIM_RANDOM
+};
+
+// Configuration used by the mystery cache interface
+static struct cache_sim_config default_config = {4096, 32, 4, SIM_LRU, 1};
+
+// Cache behind the mystery cache interface. Each thread has its own, so
+// several probes can run side by side (see cache-sweep.c).
+static __thread cache_sim* current = NULL;
+
+// Cache created by cache_init() on this thread, freed by the next call
+static __thread cache_sim* owned = NULL;
+
+
+/* Returns log2(x) if x is a power of two, otherwise -1. */
+static int log2_exact(unsigned long long x) {
+  int bits = 0;
+  if (x == 0 || (x & (x - 1)) != 0) {
+    return -1;
+  }
+  while ((1ULL << bits) != x) {
+    bits++;
+  }
+  return bits;
+}
+
+
+cache_sim* cache_sim_create(const struct cache_sim_config* config) {
+  cache_sim* sim;
+  int block_bits = log2_exact((unsigned long long) config->block_size);
+  int ways = config->assoc;
+  uint64_t lines;
+
+  if (block_bits < 0 || ways <= 0 || config->size < config->block_size * ways ||
+      config->size % (config->block_size * ways) != 0) {
+    return NULL;
+  }
+  if (config->policy == SIM_TREE_PLRU && (log2_exact(ways) < 0 || ways > 64)) {
+    return NULL;
+  }
+
+  sim = calloc(1, sizeof(*sim));
+  if (sim == NULL) {
+    return NULL;
+  }
+  sim->config = *config;
+  sim->block_bits = block_bits;
+  sim->ways = ways;
+  sim->num_sets = (uint64_t) config->size / config->block_size / ways;
+  sim->sets_pow2 = log2_exact(sim->num_sets) >= 0;
+  sim->set_mask = sim->num_sets - 1;
+  sim->rng = 88172645463325252ULL;
+
+  lines = sim->num_sets * ways;
+  sim->tags = malloc(lines * sizeof(uint64_t));
+  sim->stamps = malloc(lines * sizeof(uint32_t));
+  sim->plru = malloc(sim->num_sets * sizeof(uint64_t));
+  sim->ranks = malloc(ways * sizeof(uint32_t));
+  if (sim->tags == NULL || sim->stamps == NULL || sim->plru == NULL ||
+      sim->ranks == NULL) {
+    cache_sim_destroy(sim);
+    return NULL;
+  }
+  cache_sim_flush(sim);
+  return sim;
+}
+
+void cache_sim_destroy(cache_sim* sim) {
+  if (sim == NULL) {
+    return;
+  }
+  free(sim->tags);
+  free(sim->stamps);
+  free(sim->plru);
+  free(sim->ranks);
+  free(sim);
+}
+
+void cache_sim_flush(cache_sim* sim) {
+  uint64_t lines = sim->num_sets * sim->ways;
+  for (uint64_t i = 0; i < lines; i++) {
+    sim->tags[i] = INVALID_TAG;
+  }
+  memset(sim->stamps, 0, lines * sizeof(uint32_t));
+  memset(sim->plru, 0, sim->num_sets * sizeof(uint64_t));
+  sim->clock = 0;
+}
+
+const struct cache_sim_stats* cache_sim_get_stats(const cache_sim* sim) {
+  return &sim->stats;
+}
+
+void cache_sim_reset_stats(cache_sim* sim) {
+  memset(&sim->stats, 0, sizeof(sim->stats));
+}
+
+const struct cache_sim_config* cache_sim_get_config(const cache_sim* sim) {
+  return &sim->config;
+}
+
+
+/*
+ * renumber_stamps - Called when the 32-bit clock wraps. Replaces every stamp
+ *     by its rank within its set, which keeps the LRU/FIFO order intact, and
+ *     restarts the clock just above the largest rank.
+ */
+static void renumber_stamps(cache_sim* sim) {
+  int ways = sim->ways;
+  uint32_t* ranks = sim->ranks;
+  for (uint64_t set = 0; set < sim->num_sets; set++) {
+    uint32_t* s = sim->stamps + set * ways;
+    // Rank every way against the old stamps before overwriting any of them
+    for (int i = 0; i < ways; i++) {
+      ranks[i] = 1;
+      for (int j = 0; j < ways; j++) {
+        ranks[i] += s[j] < s[i];
+      }
+    }
+    memcpy(s, ranks, ways * sizeof(uint32_t));
+  }
+  sim->clock = (uint32_t) ways + 1;
+}
+
+/* Returns a fresh stamp. */
+static inline uint32_t tick(cache_sim* sim) {
+  if (++sim->clock == 0) {
+    renumber_stamps(sim);
+  }
+  return sim->clock;
+}
+
+
+/* Points the tree-PLRU bits of a set away from way. */
+static inline void plru_touch(uint64_t* bits, int ways, int way) {
+  int node = 1, lo = 0, hi = ways;
+  while (hi - lo > 1) {
+    int mid = (lo + hi) / 2;
+    if (way < mid) {
+      *bits |= 1ULL << node;      // next victim is on the right
+      node = 2 * node;
+      hi = mid;
+    } else {
+      *bits &= ~(1ULL << node);   // next victim is on the left
+      node = 2 * node + 1;
+      lo = mid;
+    }
+  }
+}
+
+/* Follows the tree-PLRU bits of a set to its victim. */
+static inline int plru_victim(uint64_t bits, int ways) {
+  int node = 1, lo = 0, hi = ways;
+  while (hi - lo > 1) {
+    int mid = (lo + hi) / 2;
+    if (bits & (1ULL << node)) {
+      node = 2 * node + 1;
+      lo = mid;
+    } else {
+      node = 2 * node;
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+
+/* Picks the way to replace in a full set. */
+static inline int choose_victim(cache_sim* sim, uint64_t set) {
+  const uint32_t* s = sim->stamps + set * sim->ways;
+  int victim = 0;
+
+  switch (sim->config.policy) {
+    case SIM_TREE_PLRU:
+      return plru_victim(sim->plru[set], sim->ways);
+    case SIM_RANDOM:
+      sim->rng ^= sim->rng << 13;
+      sim->rng ^= sim->rng >> 7;
+      sim->rng ^= sim->rng << 17;
+      return (int)(sim->rng % (uint64_t) sim->ways);
+    default:
+      // LRU and FIFO both evict the oldest stamp
+      for (int w = 1; w < sim->ways; w++) {
+        if (s[w] < s[victim]) {
+          victim = w;
+        }
+      }
+      return victim;
+  }
+}
+
+
+int cache_sim_access(cache_sim* sim, unsigned long long address, int is_write) {
+  uint64_t block = address >> sim->block_bits;
+  uint64_t set = sim->sets_pow2 ? (block & sim->set_mask) : (block % sim->num_sets);
+  int ways = sim->ways;
+  uint64_t* t = sim->tags + set * ways;
+  int way;
+
+  if (is_write) {
+    sim->stats.writes++;
+  } else {
+    sim->stats.reads++;
+  }
+
+  for (way = 0; way < ways; way++) {
+    if (t[way] == block) {
+      sim->stats.hits++;
+      if (sim->config.policy == SIM_LRU) {
+        sim->stamps[set * ways + way] = tick(sim);
+      } else if (sim->config.policy == SIM_TREE_PLRU) {
+        plru_touch(&sim->plru[set], ways, way);
+      }
+      return 1;
+    }
+  }
+
+  sim->stats.misses++;
+  if (is_write && !sim->config.write_allocate) {
+    return 0;
+  }
+
+  // Fill empty ways in order before replacing anything
+  for (way = 0; way < ways && t[way] != INVALID_TAG; way++) {
+  }
+  if (way == ways) {
+    way = choose_victim(sim, set);
+    sim->stats.evictions++;
+  }
+
+  t[way] = block;
+  sim->stamps[set * ways + way] = tick(sim);
+  if (sim->config.policy == SIM_TREE_PLRU) {
+    plru_touch(&sim->plru[set], ways, way);
+  }
+  return 0;
+}
+
+
+/* Simulates every block touched by size bytes starting at address. */
+static void access_range(cache_sim* sim, unsigned long long address,
+                         unsigned long long size, int is_write) {
+  unsigned long long first = address >> sim->block_bits;
+  unsigned long long last = (address + (size ? size - 1 : 0)) >> sim->block_bits;
+  for (unsigned long long b = first; b <= last; b++) {
+    cache_sim_access(sim, b << sim->block_bits, is_write);
+  }
+}
+
+long long cache_sim_run_trace(cache_sim* sim, FILE* trace,
+                              enum cache_sim_trace_format format) {
+  long long count = 0;
+
+  if (format == TRACE_BINARY) {
+    uint64_t records[TRACE_CHUNK];
+    size_t n;
+    while ((n = fread(records, sizeof(uint64_t), TRACE_CHUNK, trace)) > 0) {
+      for (size_t i = 0; i < n; i++) {
+        cache_sim_access(sim, records[i] & ~TRACE_WRITE_BIT,
+                         (records[i] & TRACE_WRITE_BIT) != 0);
+      }
+      count += (long long) n;
+    }
+    return ferror(trace) ? -1 : count;
+  }
+
+  // Lackey lines: "I  0400d7d4,8", " S 7feff03ac,8", " L ...", " M ..."
+  char line[MAX_LINE];
+  while (fgets(line, sizeof(line), trace) != NULL) {
+    char* p = line;
+    char op;
+    unsigned long long address, size = 1;
+    char* end;
+
+    while (*p == ' ') {
+      p++;
+    }
+    op = *p;
+    if (op == '\0' || op == '\n' || op == 'I' || op == '=' || op == '-') {
+      // Blank lines, instruction fetches and valgrind's own messages
+      continue;
+    }
+    if (op != 'L' && op != 'S' && op != 'M') {
+      return -1;
+    }
+    address = strtoull(p + 1, &end, 16);
+    if (end == p + 1) {
+      return -1;
+    }
+    if (*end == ',') {
+      size = strtoull(end + 1, NULL, 10);
+    }
+
+    // A modify is a load followed by a store to the same bytes
+    if (op == 'L' || op == 'M') {
+      access_range(sim, address, size, 0);
+      count++;
+    }
+    if (op == 'S' || op == 'M') {
+      access_range(sim, address, size, 1);
+      count++;
+    }
+  }
+  return ferror(trace) ? -1 : count;
+}
+
+
+int cache_sim_parse_policy(const char* name, enum cache_sim_policy* policy) {
+  if (strcmp(name, "lru") == 0) {
+    *policy = SIM_LRU;
+  } else if (strcmp(name, "fifo") == 0) {
+    *policy = SIM_FIFO;
+  } else if (strcmp(name, "plru") == 0) {
+    *policy = SIM_TREE_PLRU;
+  } else if (strcmp(name, "random") == 0) {
+    *policy = SIM_RANDOM;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+
+void cache_sim_set_default_config(const struct cache_sim_config* config) {
+  default_config = *config;
+}
+
+
+/* Applies a CACHE_SIM="size:block_size:assoc:policy[:nwa]" setting. */
+static void apply_env_config(struct cache_sim_config* c, const char* spec) {
+  char policy[16] = "";
+  char write[8] = "";
+  int fields = sscanf(spec, "%d:%d:%d:%15[a-z]:%7[a-z]", &c->size,
+                      &c->block_size, &c->assoc, policy, write);
+  if (fields >= 4 && cache_sim_parse_policy(policy, &c->policy) < 0) {
+    fprintf(stderr, "CACHE_SIM: unknown policy \"%s\"\n", policy);
+  }
+  if (fields >= 5) {
+    c->write_allocate = strcmp(write, "nwa") != 0;
+  }
+}
+
+
+/*
+ * Mystery cache interface. The course interface has no way to report errors,
+ * so an invalid configuration is fatal.
+ */
+void cache_init(int size, int block_size) {
+  struct cache_sim_config c = default_config;
+  const char* spec = getenv("CACHE_SIM");
+
+  if (spec != NULL) {
+    apply_env_config(&c, spec);
+  }
+  if (size > 0) {
+    c.size = size;
+  }
+  if (block_size > 0) {
+    c.block_size = block_size;
+  }
+
+  cache_sim_destroy(owned);
+  owned = current = cache_sim_create(&c);
+  if (current == NULL) {
+    fprintf(stderr, "cache_init: invalid cache %d:%d:%d\n", c.size,
+            c.block_size, c.assoc);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void cache_sim_bind(cache_sim* sim) {
+  current = sim;
+}
+
+bool_t access_cache(addr_t address) {
+  return (bool_t) cache_sim_access(current, address, 0);
+}
+
+bool_t write_cache(addr_t address) {
+  return (bool_t) cache_sim_access(current, address, 1);
+}
+
+void flush_cache(void) {
+  cache_sim_flush(current);
+}
@@ -0,0 +1,82 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Open Cache Simulator
+ *
+ * See cache-sim.c for details.
+ */
+
+#ifndef CACHE_SIM_H
+#define CACHE_SIM_H
+
+#include <stdio.h>
+
+// Replacement policies supported by the simulator
+enum cache_sim_policy {
+  SIM_LRU,
+  SIM_FIFO,
+  SIM_TREE_PLRU,   // needs a power-of-two associativity of at most 64
+  SIM_RANDOM,
+};
+
+// Trace file formats accepted by cache_sim_run_trace()
+enum cache_sim_trace_format {
+  TRACE_BINARY,    // little-endian 64-bit addresses, bit 63 set for writes
+  TRACE_LACKEY,    // valgrind --tool=lackey --trace-mem=yes text output
+};
+
+struct cache_sim_config {
+  int size;          // total capacity in bytes
+  int block_size;    // bytes per block, a power of two
+  int assoc;         // ways per set
+  enum cache_sim_policy policy;
+  int write_allocate;  // nonzero if a write miss loads the block
+};
+
+struct cache_sim_stats {
+  unsigned long long reads;
+  unsigned long long writes;
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;   // misses that replaced a valid block
+};
+
+typedef struct cache_sim cache_sim;
+
+/* Creates a flushed cache. Returns NULL if the geometry or policy is invalid
+ * or memory runs out. */
+cache_sim* cache_sim_create(const struct cache_sim_config* config);
+
+/* Frees a cache created by cache_sim_create. */
+void cache_sim_destroy(cache_sim* sim);
+
+/* Accesses one address. Returns 1 on a hit and 0 on a miss. */
+int cache_sim_access(cache_sim* sim, unsigned long long address, int is_write);
+
+/* Invalidates every block. Statistics are kept. */
+void cache_sim_flush(cache_sim* sim);
+
+/* Returns the statistics gathered since creation or the last reset. */
+const struct cache_sim_stats* cache_sim_get_stats(const cache_sim* sim);
+void cache_sim_reset_stats(cache_sim* sim);
+
+/* Returns the configuration the cache was created with. */
+const struct cache_sim_config* cache_sim_get_config(const cache_sim* sim);
+
+/* Feeds every access in a trace to the cache. Returns the number of accesses
+ * simulated, or -1 on a read error or malformed text trace. */
+long long cache_sim_run_trace(cache_sim* sim, FILE* trace,
+                              enum cache_sim_trace_format format);
+
+/* Parses "lru", "fifo", "plru" or "random". Returns 0 on success. */
+int cache_sim_parse_policy(const char* name, enum cache_sim_policy* policy);
+
+/* Sets the configuration used by the next cache_init() call of the mystery
+ * cache interface (see cache-sim.c). */
+void cache_sim_set_default_config(const struct cache_sim_config* config);
+
+/* Makes sim the cache behind access_cache(), write_cache() and flush_cache()
+ * for the calling thread. The caller keeps ownership of sim; a later
+ * cache_init() on this thread creates a new cache instead of freeing it. */
+void cache_sim_bind(cache_sim* sim);
+
+#endif
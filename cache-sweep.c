@@ -0,0 +1,245 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Parallel Prober Regression Sweep
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Runs the probes from cache-probe.c against hundreds of simulated caches
+ * (cache-sim.c) at once and checks every inferred geometry and policy
+ * against the true one. Replaces running cache-test once per cache_init()
+ * configuration.
+ *
+ * Each worker thread repeatedly claims the next configuration, creates its
+ * own simulated cache and binds it with cache_sim_bind(). The mystery cache
+ * interface and the probes' access counter are per-thread, so the probes run
+ * unchanged and without locking.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -pthread -o cache-sweep cache-sweep.c cache-probe.c \
+ *       cache-sim.c
+ *
+ * Usage:
+ *   ./cache-sweep [-j threads] [-r] [-q]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cache-probe.h"
+#include "cache-sim.h"
+
+// Maximum number of worker threads
+#define MAX_THREADS 256
+
+static const int sizes[] = {1 << 10, 1 << 11, 1 << 12, 1 << 13, 1 << 14,
+                            1 << 15, 1 << 16, 1 << 17, 1 << 18};
+static const int block_sizes[] = {16, 32, 64, 128};
+static const int assocs[] = {1, 2, 4, 8, 16};
+static const enum cache_sim_policy policies[] = {SIM_LRU, SIM_FIFO,
+                                                 SIM_TREE_PLRU, SIM_RANDOM};
+
+#define COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+// One configuration and what the probes made of it
+struct sweep_entry {
+  struct cache_sim_config config;
+  int block_size;
+  int size;
+  int assoc;
+  enum replacement_policy policy;
+  enum write_policy write;
+  unsigned long accesses;
+  double micros;
+  int ok;
+};
+
+struct sweep {
+  struct sweep_entry* entries;
+  int count;
+  int next;   // next unclaimed entry, taken with an atomic add
+};
+
+
+/* The policy the prober should report for a simulated cache. */
+static enum replacement_policy expected_policy(const struct cache_sim_config* c) {
+  if (c->assoc == 1) {
+    return POLICY_DIRECT_MAPPED;
+  }
+  switch (c->policy) {
+    case SIM_LRU:
+      return POLICY_LRU;
+    case SIM_FIFO:
+      return POLICY_FIFO;
+    case SIM_TREE_PLRU:
+      // With two ways the tree is a single bit, i.e. exact LRU
+      return c->assoc == 2 ? POLICY_LRU : POLICY_TREE_PLRU;
+    default:
+      return POLICY_RANDOM;
+  }
+}
+
+static const char* sim_policy_name(enum cache_sim_policy policy) {
+  switch (policy) {
+    case SIM_LRU:       return "lru";
+    case SIM_FIFO:      return "fifo";
+    case SIM_TREE_PLRU: return "plru";
+    default:            return "random";
+  }
+}
+
+
+/* Probes one simulated cache and fills in the rest of its entry. */
+static void run_entry(struct sweep_entry* e) {
+  struct timespec start, end;
+  cache_sim* sim = cache_sim_create(&e->config);
+
+  if (sim == NULL) {
+    e->ok = 0;
+    return;
+  }
+  cache_sim_bind(sim);
+  probe_reset_count();
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  e->block_size = probe_block_size();
+  e->size = probe_cache_size(e->block_size);
+  e->assoc = probe_cache_assoc(e->block_size, e->size);
+  e->policy = probe_replacement_policy(e->size, e->assoc);
+  e->write = probe_write_policy();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  e->accesses = probe_access_count();
+  e->micros = (end.tv_sec - start.tv_sec) * 1e6 +
+              (end.tv_nsec - start.tv_nsec) * 1e-3;
+  e->ok = e->block_size == e->config.block_size &&
+          e->size == e->config.size &&
+          e->assoc == e->config.assoc &&
+          e->policy == expected_policy(&e->config) &&
+          e->write == (e->config.write_allocate ? WRITE_ALLOCATE
+                                                : NO_WRITE_ALLOCATE);
+
+  cache_sim_bind(NULL);
+  cache_sim_destroy(sim);
+}
+
+static void* worker(void* arg) {
+  struct sweep* sweep = arg;
+  int i;
+  while ((i = __atomic_fetch_add(&sweep->next, 1, __ATOMIC_RELAXED)) <
+         sweep->count) {
+    run_entry(&sweep->entries[i]);
+  }
+  return NULL;
+}
+
+
+int main(int argc, char* argv[]) {
+  pthread_t threads[MAX_THREADS];
+  struct sweep sweep = {NULL, 0, 0};
+  int num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  int num_policies = COUNT(policies) - 1;   // random only with -r
+  int quiet = 0;
+  int failures = 0;
+  int started = 0;
+  struct timespec start, end;
+  double seconds;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:rqh")) != -1) {
+    switch (opt) {
+      case 'j':
+        num_threads = atoi(optarg);
+        break;
+      case 'r':
+        num_policies = COUNT(policies);
+        break;
+      case 'q':
+        quiet = 1;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-j threads] [-r] [-q]\n", argv[0]);
+        fprintf(stderr, "\t-r\talso sweep random replacement (the geometry\n");
+        fprintf(stderr, "\t\tprobes assume a deterministic policy and are\n");
+        fprintf(stderr, "\t\texpected to fail there)\n");
+        fprintf(stderr, "\t-q\tonly print failures and the summary\n");
+        return EXIT_FAILURE;
+    }
+  }
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+
+  sweep.entries = calloc((size_t) COUNT(sizes) * COUNT(block_sizes) *
+                         COUNT(assocs) * COUNT(policies), sizeof(struct sweep_entry));
+  if (sweep.entries == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  // Every valid combination, alternating write-allocate and not
+  for (int s = 0; s < COUNT(sizes); s++) {
+    for (int b = 0; b < COUNT(block_sizes); b++) {
+      for (int a = 0; a < COUNT(assocs); a++) {
+        for (int p = 0; p < num_policies; p++) {
+          struct cache_sim_config* c = &sweep.entries[sweep.count].config;
+          if (sizes[s] < block_sizes[b] * assocs[a]) {
+            continue;
+          }
+          c->size = sizes[s];
+          c->block_size = block_sizes[b];
+          c->assoc = assocs[a];
+          c->policy = policies[p];
+          c->write_allocate = sweep.count % 2 == 0;
+          sweep.count++;
+        }
+      }
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int t = 0; t < num_threads; t++) {
+    if (pthread_create(&threads[t], NULL, worker, &sweep) != 0) {
+      break;
+    }
+    started++;
+  }
+  if (started == 0) {
+    worker(&sweep);
+  }
+  for (int t = 0; t < started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+  printf("%-28s %-36s %10s %10s %s\n", "true (size:block:assoc:policy)",
+         "inferred", "accesses", "time(us)", "result");
+  for (int i = 0; i < sweep.count; i++) {
+    struct sweep_entry* e = &sweep.entries[i];
+    char truth[64], inferred[64];
+    failures += !e->ok;
+    if (e->ok && quiet) {
+      continue;
+    }
+    snprintf(truth, sizeof(truth), "%d:%d:%d:%s%s", e->config.size,
+             e->config.block_size, e->config.assoc,
+             sim_policy_name(e->config.policy),
+             e->config.write_allocate ? "" : ":nwa");
+    snprintf(inferred, sizeof(inferred), "%d:%d:%d:%s%s", e->size,
+             e->block_size, e->assoc, replacement_policy_name(e->policy),
+             e->write == NO_WRITE_ALLOCATE ? ":nwa" : "");
+    printf("%-28s %-36s %10lu %10.1f %s\n", truth, inferred, e->accesses,
+           e->micros, e->ok ? "ok" : "FAIL");
+  }
+
+  printf("\n%d configurations, %d failed, %.2f s on %d threads\n", sweep.count,
+         failures, seconds, started ? started : 1);
+  free(sweep.entries);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Fast Cache Geometry Prober Driver
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Same interface and output as cache-test (cache-test-skel.c), but runs the
+ * probes from cache-probe.c and also reports how many access_cache() calls
+ * each one needed. Also accepts "policy" (replacement policy) and "write"
+ * (write-miss policy), which are not run by default.
+ *
+ * Build against the same mystery cache objects as cache-test:
+ *   gcc -O2 -std=gnu99 -o cache-test-fast cache-test-fast.c cache-probe.c \
+ *       support/mystery-cache.o
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cache-probe.h"
+#include "support/mystery-cache.h"
+
+
+/* Run the probes on a given cache and print the results. */
+int main(int argc, char* argv[]) {
+  int size;
+  int assoc;
+  int block_size;
+  unsigned long total = 0;
+  enum replacement_policy policy;
+  enum write_policy write_policy;
+  char do_block_size, do_size, do_assoc, do_policy, do_write;
+  do_block_size = do_size = do_assoc = do_policy = do_write = 0;
+  if (argc == 1) {
+    do_block_size = do_size = do_assoc = 1;
+  } else {
+    for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "block_size") == 0) {
+        do_block_size = 1;
+        continue;
+      }
+      if (strcmp(argv[i], "size") == 0) {
+        do_size = 1;
+        continue;
+      }
+      if (strcmp(argv[i], "assoc") == 0) {
+        do_assoc = 1;
+        continue;
+      }
+      if (strcmp(argv[i], "policy") == 0) {
+        do_policy = 1;
+        continue;
+      }
+      if (strcmp(argv[i], "write") == 0) {
+        do_write = 1;
+      }
+    }
+  }
+
+  if (!do_block_size && !do_size && !do_assoc && !do_policy && !do_write) {
+    printf("No function requested!\n");
+    printf("Usage: ./cache-test-fast\n");
+    printf("Usage: ./cache-test-fast {block_size/size/assoc/policy/write}\n");
+    printf("\tyou may specify multiple functions\n");
+    return EXIT_FAILURE;
+  }
+
+  cache_init(0, 0);
+
+  size = assoc = -1;
+  probe_reset_count();
+  block_size = probe_block_size();
+  if (do_block_size) {
+    printf("Cache block size: %d bytes (%lu accesses)\n", block_size,
+           probe_access_count());
+  }
+  total += probe_access_count();
+
+  if (do_size || do_assoc || do_policy) {
+    probe_reset_count();
+    size = probe_cache_size(block_size);
+    if (do_size) {
+      printf("Cache size: %d bytes (%lu accesses)\n", size,
+             probe_access_count());
+    }
+    total += probe_access_count();
+  }
+
+  if (do_assoc || do_policy) {
+    probe_reset_count();
+    assoc = probe_cache_assoc(block_size, size);
+    if (do_assoc) {
+      printf("Cache associativity: %d (%lu accesses)\n", assoc,
+             probe_access_count());
+    }
+    total += probe_access_count();
+  }
+
+  if (do_policy) {
+    probe_reset_count();
+    policy = probe_replacement_policy(size, assoc);
+    printf("Replacement policy: %s (%lu accesses)\n",
+           replacement_policy_name(policy), probe_access_count());
+    total += probe_access_count();
+  }
+
+  if (do_write) {
+    probe_reset_count();
+    write_policy = probe_write_policy();
+    printf("Write policy: %s (%lu accesses)\n", write_policy_name(write_policy),
+           probe_access_count());
+    total += probe_access_count();
+  }
+
+  printf("Total accesses: %lu\n", total);
+  return EXIT_SUCCESS;
+}
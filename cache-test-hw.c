@@ -0,0 +1,368 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Inferring Real Cache Geometries
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * cache-test-skel.c infers a geometry by asking the mystery cache simulator
+ * whether each access hit. Real hardware does not tell us that, but a miss is
+ * slower than a hit, so the same experiments can be run by timing long chains
+ * of dependent loads (pointer chasing: each load's address comes from the
+ * previous load, so the loads cannot overlap and the average time per step is
+ * the latency of whatever level the chain lives in).
+ *
+ *   line size:  visit random 1 KiB chunks, touching offsets 0 and s in each.
+ *               While s is inside the line the second load hits; the average
+ *               latency jumps once s reaches the line size.
+ *   capacities: chase one pointer per line through a random permutation of
+ *               working sets from 4 KiB to 64 MiB. The latency steps up each
+ *               time the working set outgrows a level.
+ *   L1 assoc:   chase k lines spaced one L1 size apart (all in one set). The
+ *               latency steps up once k exceeds the number of ways. Lower
+ *               levels are physically indexed, so this only works for L1.
+ *   TLB reach:  chase one line per page, each at a different offset so the
+ *               lines spread over all cache sets. The latency steps up once
+ *               the pages outnumber the first-level data TLB entries.
+ *
+ * The results are printed next to what sysfs reports for the same core and
+ * the final config is written with cache_topology_write(), preferring sysfs
+ * values where both exist since they come straight from the CPU.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -o cache-test-hw cache-test-hw.c cache-topology.c
+ *
+ * Usage:
+ *   ./cache-test-hw [-o config_file]
+ */
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "cache-topology.h"
+
+// Smallest and largest working sets tried when looking for capacities
+#define MIN_WORKING_SET (4L << 10)
+#define MAX_WORKING_SET (64L << 20)
+
+// Dependent loads timed per measurement
+#define CHASE_STEPS (1L << 21)
+
+// A latency this many times the previous one counts as a step up
+#define STEP_RATIO 1.3
+
+// Largest line size, associativity and page count tried
+#define MAX_LINE_SIZE 512
+#define MAX_WAYS 32
+#define MAX_PAGES 16384
+
+// Size of the chunks used by the line size experiment
+#define CHUNK 1024
+
+// Fallback line size if it could not be measured
+#define DEFAULT_LINE 64
+
+// Number of cache levels looked for
+#define MAX_LEVELS 3
+
+
+/* Returns the current monotonic time in nanoseconds. */
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Small xorshift generator, so runs are reproducible. */
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+/* Shuffles n longs in place (Fisher-Yates). */
+static void shuffle(long* a, long n) {
+  for (long i = n - 1; i > 0; i--) {
+    long j = (long)(next_random() % (uint64_t)(i + 1));
+    long tmp = a[i];
+    a[i] = a[j];
+    a[j] = tmp;
+  }
+}
+
+
+/*
+ * link_chain - Turns the byte offsets offs[0..n-1] into buf into a cyclic
+ *     chain of pointers, visited in the given order.
+ */
+static void link_chain(char* buf, const long* offs, long n) {
+  for (long i = 0; i < n; i++) {
+    *(void**)(buf + offs[i]) = buf + offs[(i + 1) % n];
+  }
+}
+
+/* Follows the chain starting at start and returns nanoseconds per step. */
+static double chase(void* start, long steps) {
+  void* volatile sink;
+  void* p = start;
+  double t;
+
+  // One lap to warm up, then the timed run
+  for (long i = 0; i < steps / 8; i++) {
+    p = *(void**) p;
+  }
+  t = now_ns();
+  for (long i = 0; i < steps; i++) {
+    p = *(void**) p;
+  }
+  t = now_ns() - t;
+  sink = p;
+  (void) sink;
+  return t / steps;
+}
+
+/* Times a chain over the given offsets of buf. */
+static double chain_latency(char* buf, const long* offs, long n) {
+  link_chain(buf, offs, n);
+  return chase(buf + offs[0], CHASE_STEPS);
+}
+
+
+/* Measures the line size. Returns 0 if no step was seen. */
+static int measure_line_size(char* buf, long* offs) {
+  long chunks = MAX_WORKING_SET / CHUNK;
+  double prev = 0;
+
+  printf("# line size: stride -> ns per load\n");
+  for (int s = 8; s <= MAX_LINE_SIZE; s *= 2) {
+    long* order = offs + 2 * chunks;
+    double lat;
+    for (long i = 0; i < chunks; i++) {
+      order[i] = i * CHUNK;
+    }
+    shuffle(order, chunks);
+    // Each chunk contributes offsets 0 and s, visited back to back
+    for (long i = 0; i < chunks; i++) {
+      offs[2 * i] = order[i];
+      offs[2 * i + 1] = order[i] + s;
+    }
+    lat = chain_latency(buf, offs, 2 * chunks);
+    printf("#   %4d %8.2f\n", s, lat);
+    if (prev > 0 && lat > prev * STEP_RATIO) {
+      return s;
+    }
+    prev = lat;
+  }
+  return 0;
+}
+
+
+/* Measures up to MAX_LEVELS capacities into sizes[]. Returns how many. */
+static int measure_capacities(char* buf, long* offs, int line, long sizes[]) {
+  double prev = 0;
+  long prev_size = 0;
+  int levels = 0;
+
+  printf("# capacity: working set -> ns per load\n");
+  // Steps of sqrt(2), alternating between powers of two and 1.5x them
+  for (long ws = MIN_WORKING_SET; ws <= MAX_WORKING_SET;
+       ws = (ws & (ws - 1)) ? ws / 3 * 4 : ws / 2 * 3) {
+    long n = ws / line;
+    double lat;
+    for (long i = 0; i < n; i++) {
+      offs[i] = i * line;
+    }
+    shuffle(offs, n);
+    lat = chain_latency(buf, offs, n);
+    printf("#   %9ld %8.2f\n", ws, lat);
+    if (prev > 0 && lat > prev * STEP_RATIO && levels < MAX_LEVELS) {
+      sizes[levels++] = prev_size;
+    }
+    prev = lat;
+    prev_size = ws;
+  }
+  return levels;
+}
+
+
+/* Measures the L1 associativity, using lines of buf (buf_size bytes). Returns
+ * 0 if no step was seen among the lines that fit in buf. */
+static int measure_l1_assoc(char* buf, size_t buf_size, long* offs,
+                            long l1_size) {
+  // Lines one L1 size apart that fit in buf, each holding a pointer
+  size_t fit = (buf_size - sizeof(char*)) / (size_t) l1_size + 1;
+  int max_k = fit < MAX_WAYS ? (int) fit : MAX_WAYS;
+  double base = 0;
+
+  if (max_k < 2) {
+    printf("# L1 assoc: skipped, L1 size %ld does not fit the buffer twice\n",
+           l1_size);
+    return 0;
+  }
+  printf("# L1 assoc: lines in one set -> ns per load\n");
+  for (int k = 1; k <= max_k; k++) {
+    double lat;
+    for (int i = 0; i < k; i++) {
+      offs[i] = i * l1_size;
+    }
+    lat = chain_latency(buf, offs, k);
+    printf("#   %3d %8.2f\n", k, lat);
+    if (k == 1) {
+      base = lat;
+    } else if (lat > base * STEP_RATIO) {
+      return k - 1;
+    }
+  }
+  return 0;
+}
+
+
+/* Measures the number of first-level dTLB entries. Returns 0 if unseen. */
+static int measure_dtlb(char* buf, long* offs, int line, int page) {
+  double base = 0;
+
+  printf("# dTLB: pages -> ns per load\n");
+  for (long pages = 4; pages <= MAX_PAGES; pages *= 2) {
+    double lat;
+    for (long i = 0; i < pages; i++) {
+      offs[i] = i * page + (i * line) % page;
+    }
+    shuffle(offs, pages);
+    lat = chain_latency(buf, offs, pages);
+    printf("#   %6ld %8.2f\n", pages, lat);
+    if (pages == 4) {
+      base = lat;
+    } else if (lat > base * STEP_RATIO) {
+      return (int)(pages / 2);
+    }
+  }
+  return 0;
+}
+
+
+/* Prints one measured vs. sysfs comparison line. */
+static void compare(const char* name, long measured, long sysfs) {
+  printf("%-14s measured %10ld   sysfs %10ld%s\n", name, measured, sysfs,
+         (measured && sysfs && measured != sysfs) ? "   (MISMATCH)" : "");
+}
+
+/* Returns sysfs if known, otherwise the measured value. */
+static long prefer(long sysfs, long measured) {
+  return sysfs != 0 ? sysfs : measured;
+}
+
+
+int main(int argc, char* argv[]) {
+  struct cache_topology hw, sys, out;
+  long sizes[MAX_LEVELS] = {0};
+  const char* out_path = NULL;
+  size_t buf_size;
+  int line, page;
+  char* buf;
+  long* offs;
+  FILE* f;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:h")) != -1) {
+    switch (opt) {
+      case 'o':
+        out_path = optarg;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-o config_file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+#ifdef __linux__
+  // Stay on CPU 0 so the measurements and sysfs describe the same core
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(0, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+    perror("sched_setaffinity");
+  }
+#endif
+
+  cache_topology_clear(&hw);
+  cache_topology_clear(&sys);
+  if (cache_topology_from_sysfs(0, &sys) == 0) {
+    fprintf(stderr, "warning: no cache information in sysfs\n");
+  }
+  page = (int) sysconf(_SC_PAGESIZE);
+  hw.page_size = page;
+  buf_size = (size_t) MAX_PAGES * page;
+  if (buf_size < MAX_WORKING_SET + MAX_LINE_SIZE) {
+    buf_size = MAX_WORKING_SET + page;
+  }
+
+  buf = aligned_alloc((size_t) page, buf_size);
+  offs = malloc((MAX_WORKING_SET / 8) * sizeof(long));
+  if (buf == NULL || offs == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  // Fault everything in up front so page faults do not show up as misses
+  memset(buf, 0, buf_size);
+
+  hw.line_size = measure_line_size(buf, offs);
+  line = hw.line_size ? hw.line_size : DEFAULT_LINE;
+
+  measure_capacities(buf, offs, line, sizes);
+  hw.l1d_size = sizes[0];
+  hw.l2_size = sizes[1];
+  hw.l3_size = sizes[2];
+
+  if (prefer(sys.l1d_size, hw.l1d_size) > 0) {
+    hw.l1d_assoc = measure_l1_assoc(buf, buf_size, offs,
+                                    prefer(sys.l1d_size, hw.l1d_size));
+  }
+
+  hw.dtlb_entries = measure_dtlb(buf, offs, line, page);
+  hw.dtlb_reach = (long) hw.dtlb_entries * page;
+
+  printf("\n");
+  compare("line_size", hw.line_size, sys.line_size);
+  compare("l1d_size", hw.l1d_size, sys.l1d_size);
+  compare("l1d_assoc", hw.l1d_assoc, sys.l1d_assoc);
+  compare("l2_size", hw.l2_size, sys.l2_size);
+  compare("l3_size", hw.l3_size, sys.l3_size);
+  compare("dtlb_entries", hw.dtlb_entries, 0);
+  printf("\n");
+
+  out = hw;
+  out.line_size = (int) prefer(sys.line_size, hw.line_size);
+  out.l1d_size = prefer(sys.l1d_size, hw.l1d_size);
+  out.l1d_assoc = (int) prefer(sys.l1d_assoc, hw.l1d_assoc);
+  out.l2_size = prefer(sys.l2_size, hw.l2_size);
+  out.l2_assoc = sys.l2_assoc;
+  out.l3_size = prefer(sys.l3_size, hw.l3_size);
+  out.l3_assoc = sys.l3_assoc;
+
+  f = out_path ? fopen(out_path, "w") : stdout;
+  if (f == NULL) {
+    perror(out_path);
+    return EXIT_FAILURE;
+  }
+  if (cache_topology_write(f, &out) < 0 || (out_path && fclose(f) != 0)) {
+    fprintf(stderr, "error writing config\n");
+    return EXIT_FAILURE;
+  }
+
+  free(buf);
+  free(offs);
+  return EXIT_SUCCESS;
+}
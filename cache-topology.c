@@ -0,0 +1,191 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Cache Topology Config
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * A small "key=value" config describing the cache hierarchy of the machine,
+ * written by cache-test-hw and read back by tuning code at startup (tile
+ * sizes for the transposes, size classes for the allocator, ...). Also knows
+ * how to read the same information from Linux sysfs, which cache-test-hw uses
+ * to cross-check its measurements.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cache-topology.h"
+
+// Longest line accepted in a config or sysfs file
+#define MAX_LINE 256
+
+// Maps a config key to a field of struct cache_topology
+struct topology_key {
+  const char* name;
+  size_t offset;
+  int is_long;
+};
+
+#define INT_KEY(field) {#field, offsetof(struct cache_topology, field), 0}
+#define LONG_KEY(field) {#field, offsetof(struct cache_topology, field), 1}
+
+static const struct topology_key keys[] = {
+  INT_KEY(line_size),
+  LONG_KEY(l1d_size),
+  INT_KEY(l1d_assoc),
+  LONG_KEY(l2_size),
+  INT_KEY(l2_assoc),
+  LONG_KEY(l3_size),
+  INT_KEY(l3_assoc),
+  INT_KEY(page_size),
+  INT_KEY(dtlb_entries),
+  LONG_KEY(dtlb_reach),
+};
+
+#define NUM_KEYS (sizeof(keys) / sizeof(keys[0]))
+
+
+void cache_topology_clear(struct cache_topology* t) {
+  memset(t, 0, sizeof(*t));
+}
+
+
+/* Reads the first line of a sysfs file into buf. Returns 0 on success. */
+static int read_sysfs(const char* path, char* buf, size_t len) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    return -1;
+  }
+  if (fgets(buf, (int) len, f) == NULL) {
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  buf[strcspn(buf, "\n")] = '\0';
+  return 0;
+}
+
+/* Parses a sysfs size such as "32K" or "8192K" into bytes. */
+static long parse_size(const char* s) {
+  char* end;
+  long v = strtol(s, &end, 10);
+  switch (*end) {
+    case 'K': return v << 10;
+    case 'M': return v << 20;
+    case 'G': return v << 30;
+    default:  return v;
+  }
+}
+
+int cache_topology_from_sysfs(int cpu, struct cache_topology* t) {
+  char path[MAX_LINE];
+  char buf[MAX_LINE];
+  int levels = 0;
+
+  t->page_size = (int) sysconf(_SC_PAGESIZE);
+
+  for (int index = 0; ; index++) {
+    int level;
+    long size;
+    int assoc;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+    if (read_sysfs(path, buf, sizeof(buf)) < 0) {
+      break;
+    }
+    // Only data and unified caches matter to us
+    if (strcmp(buf, "Instruction") == 0) {
+      continue;
+    }
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+    if (read_sysfs(path, buf, sizeof(buf)) < 0) {
+      continue;
+    }
+    level = atoi(buf);
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, index);
+    size = read_sysfs(path, buf, sizeof(buf)) == 0 ? parse_size(buf) : 0;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/ways_of_associativity",
+             cpu, index);
+    assoc = read_sysfs(path, buf, sizeof(buf)) == 0 ? atoi(buf) : 0;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/coherency_line_size",
+             cpu, index);
+    if (read_sysfs(path, buf, sizeof(buf)) == 0 && level == 1) {
+      t->line_size = atoi(buf);
+    }
+
+    switch (level) {
+      case 1:
+        t->l1d_size = size;
+        t->l1d_assoc = assoc;
+        break;
+      case 2:
+        t->l2_size = size;
+        t->l2_assoc = assoc;
+        break;
+      case 3:
+        t->l3_size = size;
+        t->l3_assoc = assoc;
+        break;
+      default:
+        continue;
+    }
+    levels++;
+  }
+  return levels;
+}
+
+
+int cache_topology_write(FILE* f, const struct cache_topology* t) {
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    const char* field = (const char*) t + keys[i].offset;
+    long value = keys[i].is_long ? *(const long*) field : *(const int*) field;
+    if (value != 0 && fprintf(f, "%s=%ld\n", keys[i].name, value) < 0) {
+      return -1;
+    }
+  }
+  return ferror(f) ? -1 : 0;
+}
+
+
+int cache_topology_load(const char* path, struct cache_topology* t) {
+  char line[MAX_LINE];
+  FILE* f = fopen(path, "r");
+  if (f == NULL) {
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char* eq = strchr(line, '=');
+    if (line[0] == '#' || eq == NULL) {
+      continue;
+    }
+    *eq = '\0';
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+      if (strcmp(line, keys[i].name) == 0) {
+        char* field = (char*) t + keys[i].offset;
+        long value = strtol(eq + 1, NULL, 10);
+        if (keys[i].is_long) {
+          *(long*) field = value;
+        } else {
+          *(int*) field = (int) value;
+        }
+        break;
+      }
+    }
+  }
+
+  fclose(f);
+  return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 1 - Cache Topology Config
+ *
+ * See cache-topology.c for details.
+ */
+
+#ifndef CACHE_TOPOLOGY_H
+#define CACHE_TOPOLOGY_H
+
+#include <stdio.h>
+
+// Geometry of the data caches and data TLB of one core. A field that is 0 is
+// unknown.
+struct cache_topology {
+  int line_size;      // bytes per cache line
+  long l1d_size;      // bytes
+  int l1d_assoc;
+  long l2_size;       // bytes
+  int l2_assoc;
+  long l3_size;       // bytes
+  int l3_assoc;
+  int page_size;      // bytes per base page
+  int dtlb_entries;   // pages covered by the first-level data TLB
+  long dtlb_reach;    // dtlb_entries * page_size
+};
+
+/* Sets every field of t to 0 (unknown). */
+void cache_topology_clear(struct cache_topology* t);
+
+/* Fills t with the data and unified caches of the given CPU as reported by
+ * /sys/devices/system/cpu/cpuN/cache, plus the base page size. Fields sysfs
+ * does not provide are left untouched. Returns the number of cache levels
+ * found, or 0 if sysfs is not available. */
+int cache_topology_from_sysfs(int cpu, struct cache_topology* t);
+
+/* Writes t to f as "key=value" lines, skipping unknown fields. Returns 0 on
+ * success and -1 on a write error. */
+int cache_topology_write(FILE* f, const struct cache_topology* t);
+
+/* Reads a file written by cache_topology_write into t. Unknown keys, blank
+ * lines and lines starting with '#' are ignored, and fields missing from the
+ * file are left untouched. Returns 0 on success and -1 if the file could not
+ * be opened. */
+int cache_topology_load(const char* path, struct cache_topology* t);
+
+#endif
@@ -0,0 +1,789 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * store_client.c models one small store with a fixed global array of
+ * NUM_AISLES aisles and a global stockroom. This file provides the same
+ * operations on a store object whose number of aisles is chosen at runtime,
+ * for stores with millions of aisles.
+ *
+ * The aisle array is allocated with mmap, aligned to (and padded to a
+ * multiple of) 2 MiB and marked with MADV_HUGEPAGE once it is at least that
+ * large, so scans over it are not dominated by TLB misses. It is therefore
+ * also cache-line aligned.
+ *
+ * Every aisle operation works on a local copy of the 64-bit aisle and writes
+ * it back once through write_aisle(), which is the single place that
+ * modifies the aisle array. Scans stop as soon as their result is known:
+ * fulfilling an order stops once the order is filled, refilling stops once
+ * the stockroom is empty and skips aisles that are already full, and
+ * empty_section_with_id uses the SWAR/AVX2 scan from store_query.c.
+ *
+ * write_aisle() also keeps an index of where each item id is on the shelves:
+ * for every id, a bitset over the aisles (see bitset.c) marks the aisles with
+ * at least one nonempty section of that id, and a running total counts the
+ * id's items on all shelves. Fulfilling an order jumps straight to the marked
+ * aisles instead of checking every section of every aisle, and whether an
+ * order can be filled is answered from the totals without looking at the
+ * aisles at all. The index costs one bit per aisle per id, i.e. as much
+ * memory as the aisles themselves.
+ *
+ * Sections are also bucketed by how many items they hold: for each count from
+ * 1 to 10 a bitset over all section positions (aisle * 4 + section, so in
+ * address order) marks the sections holding exactly that many items. The
+ * section with the most items is then the first marked section of the highest
+ * nonempty bucket, which keeps the lowest-address tie-break, and a write only
+ * moves the sections whose count changed between buckets. Sections with no
+ * items are not tracked since they only matter when every section is empty,
+ * in which case the first section is the answer.
+ *
+ * Likewise every stockroom change goes through write_stock(). When a log is
+ * attached (see store_log.c), both hand each write to it, and when
+ * statistics are attached (see store_analytics.c), write_aisle() keeps them
+ * up to date.
+ *
+ * A store can also live in a file (store_create_file / store_open): the file
+ * is a header page holding the stockroom, followed by the raw aisle words,
+ * and is mapped MAP_SHARED, so the store operations work on it directly,
+ * other processes mapping the same file see every change, and reopening it
+ * needs no decoding. Only the indexes are rebuilt on open, from the aisles.
+ * They are private to the process that built them and only track its own
+ * writes, so a file has at most one writer: store_create_file and store_open
+ * hold an exclusive flock() on the file until the store is destroyed, and
+ * fail while another writer holds it. Any number of other processes can
+ * follow the writer with store_open_readonly, which maps the file read-only
+ * and builds no indexes; its queries scan the mapped aisles instead (with
+ * store_query.c), so they always see the writer's latest changes.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "aisle_manager.h"
+#include "aisle_word.h"
+#include "bitset.h"
+#include "store.h"
+#include "store_analytics.h"
+#include "store_log.h"
+#include "store_query.h"
+
+// Number of spaces in a section
+#define NUM_SPACES 10
+
+// Alignment and size granularity of large aisle arrays
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+// Identifies a store file, and where its aisles start
+#define STORE_FILE_MAGIC 0x454C494645524F54UL  // "TOREFILE"
+#define STORE_FILE_VERSION 1
+#define STORE_FILE_HEADER_BYTES 4096
+
+// The start of a store file. The aisle words follow at STORE_FILE_HEADER_BYTES
+struct store_file_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t header_bytes;
+  uint64_t num_aisles;
+  int stockroom[STORE_NUM_ITEMS];
+};
+
+struct store {
+  unsigned long* aisles;
+  size_t num_aisles;
+  void* mapping;          // the mapping holding aisles (and a file's header)
+  size_t mapped_bytes;
+  int is_file;            // mapping is of a store file
+  int read_only;          // mapped read-only, without indexes
+  int fd;                 // a writable store file, holding its lock, or -1
+  int* stockroom;         // own_stockroom, or in a store file's header
+  int own_stockroom[STORE_NUM_ITEMS];
+  bitset stocked[STORE_NUM_ITEMS];    // aisles holding items of each id
+  long shelf_items[STORE_NUM_ITEMS];  // items of each id on the shelves
+  long shelf_room[STORE_NUM_ITEMS];   // empty spaces in sections of each id
+  bitset has_room;                    // aisles that are not full
+  bitset with_items[NUM_SPACES];      // sections holding 1..10 items
+  struct store_log* log;              // where writes are logged, or NULL
+  struct store_stats* stats;          // statistics kept current, or NULL
+};
+
+
+/*
+ * map_aisles - Maps zeroed memory for num_aisles aisles. Arrays of at least
+ *     one huge page are aligned to a huge page boundary and offered to the
+ *     kernel as transparent huge pages. Returns NULL on failure.
+ */
+static unsigned long* map_aisles(size_t num_aisles, size_t* mapped_bytes) {
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  size_t bytes = num_aisles * sizeof(unsigned long);
+  size_t align = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : page;
+  size_t len = (bytes + align - 1) / align * align;
+  char* raw;
+  char* start;
+  size_t head, tail;
+
+  // Over-map by one alignment unit so an aligned start can be cut out
+  raw = mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return NULL;
+  }
+  start = (char*)(((unsigned long) raw + align - 1) / align * align);
+  head = (size_t)(start - raw);
+  tail = align - head;
+  if (head > 0) {
+    munmap(raw, head);
+  }
+  if (tail > 0) {
+    munmap(start + len, tail);
+  }
+
+#ifdef MADV_HUGEPAGE
+  if (align == HUGE_PAGE_SIZE) {
+    madvise(start, len, MADV_HUGEPAGE);
+  }
+#endif
+  *mapped_bytes = len;
+  return (unsigned long*) start;
+}
+
+
+/*
+ * new_store - Allocates a store of num_aisles aisles with empty indexes and
+ *     its own (empty) stockroom, but no aisles yet. Returns NULL if memory
+ *     runs out.
+ */
+static store* new_store(size_t num_aisles) {
+  store* s = calloc(1, sizeof(*s));
+
+  if (s == NULL) {
+    return NULL;
+  }
+  s->num_aisles = num_aisles;
+  s->stockroom = s->own_stockroom;
+  s->fd = -1;
+  // Every section of an empty aisle has id 0 and ten empty spaces
+  s->shelf_room[0] = (long) num_aisles * STORE_SECTIONS_PER_AISLE * NUM_SPACES;
+  if (bitset_init(&s->has_room, num_aisles) != 0) {
+    free(s);
+    return NULL;
+  }
+  bitset_set_all(&s->has_room);
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (bitset_init(&s->stocked[id], num_aisles) != 0) {
+      store_destroy(s);
+      return NULL;
+    }
+  }
+  for (int k = 0; k < NUM_SPACES; k++) {
+    if (bitset_init(&s->with_items[k], num_aisles * STORE_SECTIONS_PER_AISLE) != 0) {
+      store_destroy(s);
+      return NULL;
+    }
+  }
+  return s;
+}
+
+store* store_create(size_t num_aisles) {
+  store* s;
+
+  if (num_aisles == 0) {
+    return NULL;
+  }
+  // All aisles start out empty, so the empty indexes already match them
+  s = new_store(num_aisles);
+  if (s == NULL) {
+    return NULL;
+  }
+  s->aisles = map_aisles(num_aisles, &s->mapped_bytes);
+  if (s->aisles == NULL) {
+    store_destroy(s);
+    return NULL;
+  }
+  s->mapping = s->aisles;
+  return s;
+}
+
+void store_destroy(store* s) {
+  if (s == NULL) {
+    return;
+  }
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    bitset_free(&s->stocked[id]);
+  }
+  for (int k = 0; k < NUM_SPACES; k++) {
+    bitset_free(&s->with_items[k]);
+  }
+  bitset_free(&s->has_room);
+  if (s->mapping != NULL) {
+    munmap(s->mapping, s->mapped_bytes);
+  }
+  if (s->fd >= 0) {
+    close(s->fd);  // releases the writer's lock
+  }
+  free(s);
+}
+
+size_t store_num_aisles(const store* s) {
+  return s->num_aisles;
+}
+
+const unsigned long* store_aisles(const store* s) {
+  return s->aisles;
+}
+
+int store_get_stock(const store* s, unsigned short id) {
+  return id < STORE_NUM_ITEMS ? s->stockroom[id] : 0;
+}
+
+/* Stores a new count for item id in the stockroom. All stockroom updates go
+ * through here. */
+static void write_stock(store* s, unsigned short id, int count) {
+  s->stockroom[id] = count;
+  if (s->log != NULL) {
+    store_log_stock(s->log, id, count);
+  }
+}
+
+void store_set_stock(store* s, unsigned short id, int count) {
+  if (id < STORE_NUM_ITEMS && !s->read_only) {
+    write_stock(s, id, count);
+  }
+}
+
+void store_attach_log(store* s, struct store_log* log) {
+  s->log = log;
+}
+
+void store_attach_stats(store* s, struct store_stats* stats) {
+  if (stats != NULL) {
+    analytics_scan(stats, s->aisles, s->num_aisles, 1);
+  }
+  s->stats = stats;
+}
+
+
+/*
+ * shelve_items - Adds sign times the number of items and of empty spaces in
+ *     each section of aisle to the shelf totals of that section's id. Returns
+ *     the set of ids with items in aisle, as a mask with bit id set for each.
+ */
+static uint64_t shelve_items(store* s, unsigned long aisle, int sign) {
+  uint64_t counts = aisle_counts(aisle);
+  uint64_t ids = aisle_ids(aisle);
+  uint64_t stocked = 0;
+
+  for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+    int items = aisle_lane(counts, j);
+    int id = aisle_lane(ids, j);
+    s->shelf_room[id] += sign * (NUM_SPACES - items);
+    if (items > 0) {
+      s->shelf_items[id] += sign * items;
+      stocked |= 1ULL << id;
+    }
+  }
+  return stocked;
+}
+
+/*
+ * rebucket_sections - Moves each section of aisle i whose number of items
+ *     differs between old_aisle and new_aisle to the bucket of its new count.
+ */
+static void rebucket_sections(store* s, size_t i, unsigned long old_aisle,
+                              unsigned long new_aisle) {
+  uint64_t old_counts = aisle_counts(old_aisle);
+  uint64_t new_counts = aisle_counts(new_aisle);
+
+  if (old_counts == new_counts) {
+    return;
+  }
+  for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+    int old_items = aisle_lane(old_counts, j);
+    int new_items = aisle_lane(new_counts, j);
+    if (old_items != new_items) {
+      size_t section = i * STORE_SECTIONS_PER_AISLE + j;
+      if (old_items > 0) {
+        bitset_clear(&s->with_items[old_items - 1], section);
+      }
+      if (new_items > 0) {
+        bitset_set(&s->with_items[new_items - 1], section);
+      }
+    }
+  }
+}
+
+/* Updates the indexes for aisle i changing from old_aisle to new_aisle. */
+static void index_aisle(store* s, size_t i, unsigned long old_aisle,
+                        unsigned long new_aisle) {
+  uint64_t old_ids = shelve_items(s, old_aisle, -1);
+  uint64_t new_ids = shelve_items(s, new_aisle, 1);
+  uint64_t changed = old_ids ^ new_ids;
+
+  while (changed != 0) {
+    int id = __builtin_ctzll(changed);
+    if ((new_ids >> id) & 1) {
+      bitset_set(&s->stocked[id], i);
+    } else {
+      bitset_clear(&s->stocked[id], i);
+    }
+    changed &= changed - 1;
+  }
+  rebucket_sections(s, i, old_aisle, new_aisle);
+
+  if (((old_aisle & AISLE_LANE_SPACES) == AISLE_LANE_SPACES) !=
+      ((new_aisle & AISLE_LANE_SPACES) == AISLE_LANE_SPACES)) {
+    if ((new_aisle & AISLE_LANE_SPACES) == AISLE_LANE_SPACES) {
+      bitset_clear(&s->has_room, i);
+    } else {
+      bitset_set(&s->has_room, i);
+    }
+  }
+}
+
+/* Stores a new bit pattern for aisle i and updates the indexes to match. All
+ * aisle updates go through here. */
+static void write_aisle(store* s, size_t i, unsigned long aisle) {
+  index_aisle(s, i, s->aisles[i], aisle);
+  if (s->stats != NULL) {
+    analytics_update(s->stats, s->aisles[i], aisle);
+  }
+  s->aisles[i] = aisle;
+  if (s->log != NULL) {
+    store_log_aisle(s->log, i, aisle);
+  }
+}
+
+/*
+ * map_file - Maps the store file open as fd, which is len bytes long, shared
+ *     with every other process mapping it, and points s at its aisles and
+ *     stockroom. The mapping is writable unless s is read-only. Returns 0 on
+ *     success and -1 on failure.
+ */
+static int map_file(store* s, int fd, size_t len) {
+  int prot = s->read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+  char* start = mmap(NULL, len, prot, MAP_SHARED, fd, 0);
+
+  if (start == MAP_FAILED) {
+    return -1;
+  }
+  s->mapping = start;
+  s->mapped_bytes = len;
+  s->is_file = 1;
+  s->aisles = (unsigned long*)(start + STORE_FILE_HEADER_BYTES);
+  s->stockroom = ((struct store_file_header*) start)->stockroom;
+  return 0;
+}
+
+store* store_create_file(const char* path, size_t num_aisles) {
+  size_t len = STORE_FILE_HEADER_BYTES + num_aisles * sizeof(unsigned long);
+  struct store_file_header* h;
+  store* s;
+  int fd;
+
+  if (num_aisles == 0) {
+    return NULL;
+  }
+  s = new_store(num_aisles);
+  if (s == NULL) {
+    return NULL;
+  }
+  // The new file reads as zeros, i.e. empty aisles and an empty stockroom
+  fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    store_destroy(s);
+    return NULL;
+  }
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0 || ftruncate(fd, (off_t) len) != 0 ||
+      map_file(s, fd, len) != 0) {
+    close(fd);
+    unlink(path);
+    store_destroy(s);
+    return NULL;
+  }
+  s->fd = fd;
+
+  h = s->mapping;
+  h->version = STORE_FILE_VERSION;
+  h->header_bytes = STORE_FILE_HEADER_BYTES;
+  h->num_aisles = num_aisles;
+  // Written last, so a file is only recognized once the rest is in place
+  h->magic = STORE_FILE_MAGIC;
+  return s;
+}
+
+/*
+ * open_file - Opens the store file at path for writing (taking the writer's
+ *     lock) or read-only, checks its header and returns the open file, or -1
+ *     on failure. Stores its length in *len and its number of aisles in
+ *     *num_aisles.
+ */
+static int open_file(const char* path, int read_only, size_t* len,
+                     size_t* num_aisles) {
+  struct store_file_header h;
+  struct stat st;
+  int fd = open(path, read_only ? O_RDONLY : O_RDWR);
+
+  if (fd < 0) {
+    return -1;
+  }
+  if ((!read_only && flock(fd, LOCK_EX | LOCK_NB) != 0) ||
+      fstat(fd, &st) != 0 || (size_t) st.st_size < STORE_FILE_HEADER_BYTES ||
+      pread(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) ||
+      h.magic != STORE_FILE_MAGIC || h.version != STORE_FILE_VERSION ||
+      h.header_bytes != STORE_FILE_HEADER_BYTES || h.num_aisles == 0 ||
+      ((size_t) st.st_size - STORE_FILE_HEADER_BYTES) / sizeof(unsigned long) <
+          h.num_aisles) {
+    close(fd);
+    return -1;
+  }
+  *len = (size_t) st.st_size;
+  *num_aisles = (size_t) h.num_aisles;
+  return fd;
+}
+
+store* store_open(const char* path) {
+  size_t len, num_aisles;
+  store* s;
+  int fd = open_file(path, 0, &len, &num_aisles);
+
+  if (fd < 0) {
+    return NULL;
+  }
+  s = new_store(num_aisles);
+  if (s == NULL || map_file(s, fd, len) != 0) {
+    close(fd);
+    store_destroy(s);
+    return NULL;
+  }
+  s->fd = fd;
+
+  // The indexes are not stored in the file; rebuild them from the aisles
+  for (size_t i = 0; i < s->num_aisles; i++) {
+    if (s->aisles[i] != 0) {
+      index_aisle(s, i, 0, s->aisles[i]);
+    }
+  }
+  return s;
+}
+
+store* store_open_readonly(const char* path) {
+  size_t len, num_aisles;
+  store* s;
+  int fd = open_file(path, 1, &len, &num_aisles);
+
+  if (fd < 0) {
+    return NULL;
+  }
+  // No indexes: they could not follow the writer's changes
+  s = calloc(1, sizeof(*s));
+  if (s == NULL) {
+    close(fd);
+    return NULL;
+  }
+  s->num_aisles = num_aisles;
+  s->read_only = 1;
+  s->fd = -1;
+  if (map_file(s, fd, len) != 0) {
+    close(fd);
+    free(s);
+    return NULL;
+  }
+  close(fd);
+  return s;
+}
+
+int store_sync(store* s) {
+  if (!s->is_file || s->read_only) {
+    return 0;
+  }
+  return msync(s->mapping, s->mapped_bytes, MS_SYNC) == 0 ? 0 : -1;
+}
+
+
+void store_set_aisle(store* s, size_t i, unsigned long aisle) {
+  if (i < s->num_aisles && !s->read_only) {
+    write_aisle(s, i, aisle);
+  }
+}
+
+
+/* Starting from the first aisle, refill as many sections as possible using
+ * items from the stockroom, filling lower addresses first. Same behavior as
+ * refill_from_stockroom in store_client.c.
+ *
+ * Instead of looking up the stockroom section by section, this plans the
+ * refill per id first. The index already knows how many empty spaces every
+ * id's sections have in total, so each id's share of the stockroom,
+ * min(stock, empty spaces), is known up front: that is exactly what the
+ * section by section walk would hand out. The sweep then only visits aisles
+ * that are not full (via the has_room index), fills each one with a single
+ * write, and stops as soon as every share is used up, not only when the
+ * whole stockroom is.
+ */
+void store_refill_from_stockroom(store* s) {
+  int share[STORE_NUM_ITEMS];
+  int budget[STORE_NUM_ITEMS];      // what is left of each share
+  long remaining = 0;
+
+  if (s->read_only) {
+    return;
+  }
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    long items = s->stockroom[id] < s->shelf_room[id] ? s->stockroom[id]
+                                                      : s->shelf_room[id];
+    share[id] = items > 0 ? (int) items : 0;
+    budget[id] = share[id];
+    remaining += share[id];
+  }
+
+  for (size_t i = bitset_next(&s->has_room, 0);
+       i < s->num_aisles && remaining > 0;
+       i = bitset_next(&s->has_room, i + 1)) {
+    unsigned long aisle = s->aisles[i];
+    uint64_t ids = aisle_ids(aisle);
+    uint64_t room = aisle_room(aisle);
+    uint64_t amounts = 0;
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      int id = aisle_lane(ids, j);
+      int items_to_add = aisle_lane(room, j);
+      if (budget[id] < items_to_add) {
+        items_to_add = budget[id];
+      }
+      budget[id] -= items_to_add;
+      remaining -= items_to_add;
+      amounts |= (uint64_t) items_to_add << (16 * j);
+    }
+    if (amounts != 0) {
+      write_aisle(s, i, aisle_fill(aisle, amounts));
+    }
+  }
+
+  // Take what was handed out from the stockroom, one write per id
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (share[id] > 0) {
+      write_stock(s, (unsigned short) id, s->stockroom[id] - share[id]);
+    }
+  }
+}
+
+
+/* Removes at most num items with the given id from the local copy of an aisle,
+ * lower sections first, and returns the number removed. */
+static int take_items(unsigned long* aisle, unsigned short id, int num) {
+  int items_removed = 0;
+
+  for (int j = 0; j < STORE_SECTIONS_PER_AISLE && items_removed < num; j++) {
+    if (get_id(aisle, j) == id) {
+      int num_to_remove = num_items(aisle, j);
+      if (num - items_removed < num_to_remove) {
+        num_to_remove = num - items_removed;
+      }
+      if (num_to_remove > 0) {
+        remove_items(aisle, j, num_to_remove);
+        items_removed += num_to_remove;
+      }
+    }
+  }
+  return items_removed;
+}
+
+/* Remove at most num items with the given id from the aisles (lower addresses
+ * first) and then the stockroom, and return the number removed. Same behavior
+ * as fulfill_order in store_client.c; num <= 0 removes nothing.
+ */
+int store_fulfill_order(store* s, unsigned short id, int num) {
+  int items_removed = 0;
+
+  if (id >= STORE_NUM_ITEMS || num <= 0 || s->read_only) {
+    return 0;
+  }
+
+  // Only visit aisles that hold the id, still in increasing address order
+  for (size_t i = bitset_next(&s->stocked[id], 0);
+       i < s->num_aisles && items_removed < num;
+       i = bitset_next(&s->stocked[id], i + 1)) {
+    unsigned long aisle = s->aisles[i];
+    items_removed += take_items(&aisle, id, num - items_removed);
+    if (aisle != s->aisles[i]) {
+      write_aisle(s, i, aisle);
+    }
+  }
+
+  // Take whatever is still missing from the stockroom, if it has it
+  if (items_removed < num) {
+    int from_stock = num - items_removed;
+    if (s->stockroom[id] < from_stock) {
+      from_stock = s->stockroom[id] > 0 ? s->stockroom[id] : 0;
+    }
+    if (from_stock > 0) {
+      write_stock(s, id, s->stockroom[id] - from_stock);
+    }
+    items_removed += from_stock;
+  }
+  return items_removed;
+}
+
+
+/*
+ * fulfill_id - Fulfills the count orders of one id listed (as indexes into
+ *     orders) in group, in that order, storing each order's count in filled.
+ *     Returns the total number of items removed.
+ *
+ *     A run of fulfill_order calls for the same id drains that id's sections
+ *     strictly from the lowest address up, so each order starts in the aisle
+ *     where the previous one stopped. One walk over the id's aisles therefore
+ *     serves the whole group, each aisle is written once no matter how many
+ *     orders take from it, and the stockroom is written once at the end.
+ */
+static long fulfill_id(store* s, unsigned short id,
+                       const struct store_order* orders, const size_t* group,
+                       size_t count, int* filled) {
+  size_t i = bitset_next(&s->stocked[id], 0);
+  unsigned long aisle = i < s->num_aisles ? s->aisles[i] : 0;
+  int stock = s->stockroom[id];
+  long total = 0;
+
+  for (size_t k = 0; k < count; k++) {
+    int num = orders[group[k]].num;
+    int items_removed = 0;
+
+    while (i < s->num_aisles && items_removed < num) {
+      items_removed += take_items(&aisle, id, num - items_removed);
+      if (items_removed < num) {
+        // This aisle has no more items of the id; move on to the next one
+        write_aisle(s, i, aisle);
+        i = bitset_next(&s->stocked[id], i + 1);
+        aisle = i < s->num_aisles ? s->aisles[i] : 0;
+      }
+    }
+    if (items_removed < num && stock > 0) {
+      int from_stock = num - items_removed < stock ? num - items_removed : stock;
+      stock -= from_stock;
+      items_removed += from_stock;
+    }
+    filled[group[k]] = items_removed;
+    total += items_removed;
+  }
+
+  if (i < s->num_aisles && aisle != s->aisles[i]) {
+    write_aisle(s, i, aisle);
+  }
+  if (stock != s->stockroom[id]) {
+    write_stock(s, id, stock);
+  }
+  return total;
+}
+
+long store_fulfill_batch(store* s, const struct store_order* orders,
+                         size_t count, int* filled) {
+  size_t starts[STORE_NUM_ITEMS + 1] = {0};
+  size_t* group;
+  long total = 0;
+
+  if (s->read_only) {
+    memset(filled, 0, count * sizeof(int));
+    return 0;
+  }
+  group = malloc(count * sizeof(size_t));
+  if (group == NULL) {
+    // Same result, just one order at a time
+    for (size_t k = 0; k < count; k++) {
+      filled[k] = store_fulfill_order(s, orders[k].id, orders[k].num);
+      total += filled[k];
+    }
+    return total;
+  }
+
+  // Counting sort of the valid orders by id, keeping arrival order within an
+  // id; the rest get nothing, like store_fulfill_order
+  for (size_t k = 0; k < count; k++) {
+    if (orders[k].id < STORE_NUM_ITEMS && orders[k].num > 0) {
+      starts[orders[k].id + 1]++;
+    } else {
+      filled[k] = 0;
+    }
+  }
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    starts[id + 1] += starts[id];
+  }
+  {
+    size_t next[STORE_NUM_ITEMS];
+    memcpy(next, starts, sizeof(next));
+    for (size_t k = 0; k < count; k++) {
+      if (orders[k].id < STORE_NUM_ITEMS && orders[k].num > 0) {
+        group[next[orders[k].id]++] = k;
+      }
+    }
+  }
+
+  // Orders of different ids touch disjoint sections and stockroom counts,
+  // so each id's orders can be handled on their own
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (starts[id + 1] > starts[id]) {
+      total += fulfill_id(s, (unsigned short) id, orders, group + starts[id],
+                          starts[id + 1] - starts[id], filled);
+    }
+  }
+  free(group);
+  return total;
+}
+
+
+/* Counts the items of id on the shelves of a store without indexes. */
+static long count_shelf_items(const store* s, unsigned short id) {
+  long items = 0;
+
+  for (size_t i = 0; i < s->num_aisles; i++) {
+    uint64_t counts = aisle_counts(s->aisles[i]);
+    uint64_t ids = aisle_ids(s->aisles[i]);
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      if (aisle_lane(ids, j) == id) {
+        items += aisle_lane(counts, j);
+      }
+    }
+  }
+  return items;
+}
+
+long store_shelf_items(const store* s, unsigned short id) {
+  if (id >= STORE_NUM_ITEMS) {
+    return 0;
+  }
+  return s->read_only ? count_shelf_items(s, id) : s->shelf_items[id];
+}
+
+int store_can_fill(const store* s, unsigned short id, int num) {
+  long available;
+
+  if (id >= STORE_NUM_ITEMS) {
+    return num <= 0;
+  }
+  available = store_shelf_items(s, id) +
+              (s->stockroom[id] > 0 ? s->stockroom[id] : 0);
+  return num <= available;
+}
+
+
+unsigned short* store_empty_section_with_id(store* s, unsigned short id) {
+  return bulk_empty_section_with_id(s->aisles, s->num_aisles, id);
+}
+
+unsigned short* store_section_with_most_items(store* s) {
+  if (s->read_only) {
+    return bulk_section_with_most_items(s->aisles, s->num_aisles);
+  }
+  for (int k = NUM_SPACES - 1; k >= 0; k--) {
+    if (bitset_any(&s->with_items[k])) {
+      return (unsigned short*) s->aisles + bitset_next(&s->with_items[k], 0);
+    }
+  }
+  // Every section is empty, so the first one has (as many as) the most items
+  return (unsigned short*) s->aisles;
+}
@@ -0,0 +1,104 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * A store with a runtime-sized array of aisles. See store.c for details.
+ */
+
+#ifndef STORE_H
+#define STORE_H
+
+#include <stddef.h>
+
+// Number of items in the stockroom (2^6 different id combinations)
+#define STORE_NUM_ITEMS 64
+
+// Number of sections per aisle
+#define STORE_SECTIONS_PER_AISLE 4
+
+typedef struct store store;
+
+struct store_log;
+struct store_stats;
+
+/* Creates a store with num_aisles empty aisles and an empty stockroom.
+ * Returns NULL if num_aisles is 0 or memory runs out. */
+store* store_create(size_t num_aisles);
+
+/* Creates a store with num_aisles empty aisles and an empty stockroom that
+ * lives in a new file at path, shared with every process that opens it. The
+ * returned store is the file's only writer until it is destroyed. Returns
+ * NULL if num_aisles is 0, the file already exists or can not be created,
+ * or memory runs out. */
+store* store_create_file(const char* path, size_t num_aisles);
+
+/* Opens the store in the file at path made by store_create_file as its only
+ * writer. Returns NULL if it can not be opened, is not a store file, or
+ * another store (in any process) has it open for writing. */
+store* store_open(const char* path);
+
+/* Opens the store in the file at path read-only, next to its writer if it
+ * has one. Queries always see the writer's latest changes, but scan the
+ * aisles instead of using indexes. Writes to the store are ignored and
+ * orders remove nothing. Returns NULL if it can not be opened or is not a
+ * store file. */
+store* store_open_readonly(const char* path);
+
+/* Writes the changes to a file-backed store out to its file and waits until
+ * they are on disk. Returns 0 on success (and for stores not in a file) and
+ * -1 on an I/O error. */
+int store_sync(store* s);
+
+/* Frees a store created by store_create or opened from a file.
+ * The changes to a file-backed store stay in its file, even without a
+ * store_sync, unless the system crashes. */
+void store_destroy(store* s);
+
+/* Returns the number of aisles in the store. */
+size_t store_num_aisles(const store* s);
+
+/* Returns the store's aisles. They must only be modified through the store_
+ * functions below. */
+const unsigned long* store_aisles(const store* s);
+
+/* Replaces aisle i with the given bit pattern. */
+void store_set_aisle(store* s, size_t i, unsigned long aisle);
+
+/* Returns / sets the number of items with the given id in the stockroom. */
+int store_get_stock(const store* s, unsigned short id);
+void store_set_stock(store* s, unsigned short id, int count);
+
+/* The store_client.c operations, on this store's aisles and stockroom. */
+void store_refill_from_stockroom(store* s);
+int store_fulfill_order(store* s, unsigned short id, int num);
+unsigned short* store_empty_section_with_id(store* s, unsigned short id);
+unsigned short* store_section_with_most_items(store* s);
+
+struct store_order {
+  unsigned short id;
+  int num;
+};
+
+/* Fulfills count orders at once. Stores in filled[k] what
+ * store_fulfill_order(s, orders[k].id, orders[k].num) would have returned if
+ * the orders had been fulfilled one by one in order, leaves the store in the
+ * same state, and returns the total number of items removed. */
+long store_fulfill_batch(store* s, const struct store_order* orders,
+                         size_t count, int* filled);
+
+/* Returns the number of items with the given id on the shelves of all aisles,
+ * without scanning them (except in a read-only store). */
+long store_shelf_items(const store* s, unsigned short id);
+
+/* Returns whether store_fulfill_order(s, id, num) would remove all num items,
+ * without scanning the aisles (except in a read-only store). */
+int store_can_fill(const store* s, unsigned short id, int num);
+
+/* Makes every later aisle and stockroom write of s go to log as well, or
+ * stops logging if log is NULL. Used by store_log_open/close. */
+void store_attach_log(store* s, struct store_log* log);
+
+/* Computes the statistics of s's aisles into stats and keeps them up to date
+ * as the aisles change, until stats is replaced or is NULL. */
+void store_attach_stats(store* s, struct store_stats* stats);
+
+#endif
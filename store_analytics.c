@@ -0,0 +1,220 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Store-wide statistics: how many items of each id are on the shelves, how
+ * many sections hold each number of items, and how full each aisle is. They
+ * work on any aisle array (store_client.c's, a store's, or a concurrent
+ * store's) and are computed one whole aisle at a time with the lane helpers
+ * of aisle_word.h instead of calling get_id and num_items per section.
+ *
+ *   - analytics_scan computes everything in one pass. The aisles are split
+ *     into contiguous chunks, one per thread, each counting into its own
+ *     store_stats that are summed at the end. Counts are kept in separate
+ *     tables per section index, so the four sections of an aisle never
+ *     update the same counter back to back.
+ *   - analytics_fill_rates is a popcount per aisle with no branches, which
+ *     the compiler vectorizes.
+ *   - analytics_update keeps a store_stats current as aisles change: it
+ *     subtracts the old aisle's contribution and adds the new one's, in
+ *     constant time. store_attach_stats hooks it into every aisle write of a
+ *     store.
+ *
+ * Chunks are at least MIN_CHUNK aisles, so small arrays are scanned by the
+ * calling thread alone.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "aisle_word.h"
+#include "store_analytics.h"
+
+// Spaces in an aisle
+#define AISLE_SPACES (AISLE_SECTIONS * AISLE_MAX_ITEMS)
+
+// Most threads a scan uses
+#define MAX_THREADS 64
+
+// Fewest aisles worth handing to a thread
+#define MIN_CHUNK (1 << 16)
+
+struct scan_job {
+  const unsigned long* aisles;
+  size_t begin;
+  size_t end;
+  struct store_stats stats;
+  float* rates;
+};
+
+
+/* Counts aisles[begin..end) into stats. */
+static void scan_range(struct store_stats* stats, const unsigned long* aisles,
+                       size_t begin, size_t end) {
+  long items[AISLE_SECTIONS][STORE_NUM_ITEMS] = {{0}};
+  long sections[AISLE_SECTIONS][STORE_NUM_ITEMS] = {{0}};
+  long occupancy[AISLE_SECTIONS][ANALYTICS_MAX_ITEMS + 1] = {{0}};
+
+  for (size_t i = begin; i < end; i++) {
+    uint64_t counts = aisle_counts(aisles[i]);
+    uint64_t ids = aisle_ids(aisles[i]);
+    for (int j = 0; j < AISLE_SECTIONS; j++) {
+      int count = aisle_lane(counts, j);
+      int id = aisle_lane(ids, j);
+      items[j][id] += count;
+      sections[j][id]++;
+      occupancy[j][count]++;
+    }
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  stats->num_aisles = end - begin;
+  for (int j = 0; j < AISLE_SECTIONS; j++) {
+    for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+      stats->shelf_items[id] += items[j][id];
+      stats->sections[id] += sections[j][id];
+      stats->total_items += items[j][id];
+    }
+    for (int k = 0; k <= ANALYTICS_MAX_ITEMS; k++) {
+      stats->occupancy[k] += occupancy[j][k];
+    }
+  }
+}
+
+/* Stores the fill rate of aisles[begin..end) in rates[begin..end). */
+static void rate_range(const unsigned long* aisles, size_t begin, size_t end,
+                       float* rates) {
+  for (size_t i = begin; i < end; i++) {
+    rates[i] = (float) __builtin_popcountll(aisles[i] & AISLE_LANE_SPACES) /
+               AISLE_SPACES;
+  }
+}
+
+static void* scan_worker(void* arg) {
+  struct scan_job* job = arg;
+
+  if (job->rates != NULL) {
+    rate_range(job->aisles, job->begin, job->end, job->rates);
+  } else {
+    scan_range(&job->stats, job->aisles, job->begin, job->end);
+  }
+  return NULL;
+}
+
+/*
+ * run_jobs - Splits aisles[0..num_aisles) into up to num_threads chunks and
+ *     runs scan_worker on each, the first on the calling thread. If rates is
+ *     NULL the jobs count statistics, otherwise they compute fill rates into
+ *     it. Returns the number of jobs; jobs[0..that) hold their results.
+ */
+static int run_jobs(struct scan_job* jobs, const unsigned long* aisles,
+                    size_t num_aisles, float* rates, int num_threads) {
+  pthread_t threads[MAX_THREADS];
+  int started[MAX_THREADS] = {0};
+  size_t max_jobs = num_aisles / MIN_CHUNK;
+  int num_jobs;
+
+  if (num_threads < 1) {
+    num_threads = 1;
+  } else if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+  num_jobs = max_jobs < (size_t) num_threads ? (int) max_jobs : num_threads;
+  if (num_jobs < 1) {
+    num_jobs = 1;
+  }
+  for (int t = 0; t < num_jobs; t++) {
+    jobs[t].aisles = aisles;
+    jobs[t].begin = num_aisles * t / num_jobs;
+    jobs[t].end = num_aisles * (t + 1) / num_jobs;
+    jobs[t].rates = rates;
+  }
+
+  for (int t = 1; t < num_jobs; t++) {
+    started[t] = pthread_create(&threads[t], NULL, scan_worker, &jobs[t]) == 0;
+  }
+  scan_worker(&jobs[0]);
+  for (int t = 1; t < num_jobs; t++) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    } else {
+      scan_worker(&jobs[t]);  // no thread for it, do it here
+    }
+  }
+  return num_jobs;
+}
+
+
+void analytics_scan(struct store_stats* stats, const unsigned long* aisles,
+                    size_t num_aisles, int num_threads) {
+  struct scan_job jobs[MAX_THREADS];
+  int num_jobs = run_jobs(jobs, aisles, num_aisles, NULL, num_threads);
+
+  *stats = jobs[0].stats;
+  for (int t = 1; t < num_jobs; t++) {
+    const struct store_stats* part = &jobs[t].stats;
+    stats->num_aisles += part->num_aisles;
+    stats->total_items += part->total_items;
+    for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+      stats->shelf_items[id] += part->shelf_items[id];
+      stats->sections[id] += part->sections[id];
+    }
+    for (int k = 0; k <= ANALYTICS_MAX_ITEMS; k++) {
+      stats->occupancy[k] += part->occupancy[k];
+    }
+  }
+}
+
+void analytics_update(struct store_stats* stats, unsigned long old_aisle,
+                      unsigned long new_aisle) {
+  uint64_t old_counts = aisle_counts(old_aisle);
+  uint64_t new_counts = aisle_counts(new_aisle);
+  uint64_t old_ids = aisle_ids(old_aisle);
+  uint64_t new_ids = aisle_ids(new_aisle);
+
+  if (old_aisle == new_aisle) {
+    return;
+  }
+  for (int j = 0; j < AISLE_SECTIONS; j++) {
+    int old_count = aisle_lane(old_counts, j);
+    int new_count = aisle_lane(new_counts, j);
+    int old_id = aisle_lane(old_ids, j);
+    int new_id = aisle_lane(new_ids, j);
+    stats->shelf_items[old_id] -= old_count;
+    stats->shelf_items[new_id] += new_count;
+    stats->sections[old_id]--;
+    stats->sections[new_id]++;
+    stats->occupancy[old_count]--;
+    stats->occupancy[new_count]++;
+    stats->total_items += new_count - old_count;
+  }
+}
+
+void analytics_fill_rates(const unsigned long* aisles, size_t num_aisles,
+                          float* rates, int num_threads) {
+  struct scan_job jobs[MAX_THREADS];
+
+  run_jobs(jobs, aisles, num_aisles, rates, num_threads);
+}
+
+double analytics_fill_rate(const struct store_stats* stats) {
+  if (stats->num_aisles == 0) {
+    return 0;
+  }
+  return (double) stats->total_items / ((double) stats->num_aisles * AISLE_SPACES);
+}
+
+int analytics_low_stock(const struct store_stats* stats, long threshold,
+                        unsigned short* ids) {
+  int count = 0;
+
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (stats->shelf_items[id] < threshold) {
+      ids[count++] = (unsigned short) id;
+    }
+  }
+  return count;
+}
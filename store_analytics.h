@@ -0,0 +1,50 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Occupancy statistics and low-stock reports over an array of aisles. See
+ * store_analytics.c for details.
+ */
+
+#ifndef STORE_ANALYTICS_H
+#define STORE_ANALYTICS_H
+
+#include <stddef.h>
+
+#include "store.h"
+
+// Most items a section can hold
+#define ANALYTICS_MAX_ITEMS 10
+
+struct store_stats {
+  size_t num_aisles;
+  long total_items;                           // items on all shelves
+  long shelf_items[STORE_NUM_ITEMS];          // items of each id on the shelves
+  long sections[STORE_NUM_ITEMS];             // sections labeled with each id
+  long occupancy[ANALYTICS_MAX_ITEMS + 1];    // sections holding 0..10 items
+};
+
+/* Computes the statistics of aisles[0..num_aisles) into stats, splitting the
+ * aisles over up to num_threads threads including the calling one (at least
+ * one, whatever num_threads is). */
+void analytics_scan(struct store_stats* stats, const unsigned long* aisles,
+                    size_t num_aisles, int num_threads);
+
+/* Updates stats for one of its aisles changing from old_aisle to new_aisle. */
+void analytics_update(struct store_stats* stats, unsigned long old_aisle,
+                      unsigned long new_aisle);
+
+/* Stores in rates[i] the fraction (0 to 1) of the spaces of aisles[i] that
+ * hold an item, for every i < num_aisles, using up to num_threads threads. */
+void analytics_fill_rates(const unsigned long* aisles, size_t num_aisles,
+                          float* rates, int num_threads);
+
+/* Returns the fraction of all spaces that hold an item, or 0 for no aisles. */
+double analytics_fill_rate(const struct store_stats* stats);
+
+/* Stores in ids, in increasing order, the ids with fewer than threshold
+ * items on the shelves, and returns how many there are. ids must have room
+ * for STORE_NUM_ITEMS entries. */
+int analytics_low_stock(const struct store_stats* stats, long threshold,
+                        unsigned short* ids);
+
+#endif
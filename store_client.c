@@ -12,8 +12,11 @@
  */
 
 #include <stddef.h>  // To be able to use NULL
+#include <stdint.h>
 #include "aisle_manager.h"
+#include "aisle_word.h"
 #include "store_client.h"
+#include "store_query.h"
 #include "store_util.h"
 
 // Number of aisles in the store
@@ -42,33 +45,28 @@ int stockroom[NUM_ITEMS];
  * before moving onto the next section.
  */
 void refill_from_stockroom() {
-  // TODO: implement this function
-  int id = 0;
-  int shelf = 0;
-  int items_to_add = 0;
-  int backshelf = 0;
-  for(int i = 0; i < NUM_AISLES; i++){//looping through aisles
-	  unsigned long* aisle = &aisles[i];
-  //We use a pointer to point to the address of the aisle we want because the functions relating to sections want a pointer and to avoid segmentation fault
-	  for(int j = 0; j < 4; j++){
-		  id = get_id(aisle, j);
-		  //id of the current aisle and section
-		  shelf = num_items(aisle, j);
-		  //current amount of items in aisle
-		  backshelf = stockroom[id];
-		  //backroom count
-		  items_to_add = 10 - shelf;
-		  //the difference with 10 is the amount we want to add since 10 is the max
-		  
-	          if(backshelf < items_to_add){
-			items_to_add = backshelf;
-	          }//if we dont have enough, add as much as we can		
-		  stockroom[id] -= items_to_add;//update stockroom
-		  add_items(aisle, j, items_to_add); //actually add
-          }
-   }
-
-
+  // Works on whole aisles (see aisle_word.h): one load gives all four ids and
+  // all four free space counts, and one store fills all four sections
+  for (int i = 0; i < NUM_AISLES; i++) {
+    unsigned long aisle = aisles[i];
+    uint64_t ids = aisle_ids(aisle);
+    uint64_t room = aisle_room(aisle);
+    uint64_t amounts = 0;
+    for (int j = 0; j < SECTIONS_PER_AISLE; j++) {
+      int id = aisle_lane(ids, j);
+      int items_to_add = aisle_lane(room, j);
+      if (stockroom[id] < items_to_add) {
+        items_to_add = stockroom[id];
+      }//if we dont have enough, add as much as we can
+      if (items_to_add > 0) {
+        stockroom[id] -= items_to_add;//update stockroom
+        amounts |= (uint64_t) items_to_add << (16 * j);
+      }
+    }
+    if (amounts != 0) {
+      aisles[i] = aisle_fill(aisle, amounts);
+    }
+  }
 }
 
 /* Remove at most num items from sections with the given item id, starting with
@@ -124,22 +122,8 @@ int fulfill_order(unsigned short id, int num) {
  * stockroom). Break ties by returning the section with the lowest address.
  */
 unsigned short* empty_section_with_id(unsigned short id) {
-  // TODO: implement this function
-  int items = 0;
-  for(int i = 0; i < NUM_AISLES; i++){
-  	unsigned long* aisle = &aisles[i];
-	//see above
-	for(int j = 0; j < 4; j++){
-		items = num_items(aisle, j);
-		//just getting the items
-		if(items == 0 && get_id(aisle, j) == id){//if that section had no items and matched the given item by id
-			 return ((unsigned short*)aisle) + j;
-			 //start at the aisle but cast it as a short for scaling and add j to get to the correct section
-		}
-	}
-  }
-
-  return NULL;
+  // Checks all four sections of an aisle at once, see store_query.c
+  return bulk_empty_section_with_id(aisles, NUM_AISLES, id);
 }
 
 /* Return a pointer to the section with the most items in the store. Only
@@ -147,23 +131,6 @@ unsigned short* empty_section_with_id(unsigned short id) {
  * the stockroom). Break ties by returning the section with the lowest address.
  */
 unsigned short* section_with_most_items() {
-  // TODO: implement this function
-  int items = 0;
-  int cur_max_items = 0; //max tracker
-  int cur_aisle = 0; //tracks location
-  int cur_sec = 0;  //tracks location
-  for(int i = 0; i < NUM_AISLES; i++){
-        unsigned long* aisle = &aisles[i];
-        for(int j = 0; j < 4; j++){
-                items = num_items(aisle, j);
-		if(items > cur_max_items){//if the location we are looking at has more items that our current winner
-			cur_max_items = items;
-			cur_aisle = i;
-			cur_sec = j;
-		}
-
-        }
-  }
-  return  ((unsigned short*)(aisles + cur_aisle)) + cur_sec;
-  //Similar to one right above but we just neext to get to our correct aisle first since we return AFTER looking at everything
+  // Counts all four sections of an aisle at once, see store_query.c
+  return bulk_section_with_most_items(aisles, NUM_AISLES);
 }
@@ -0,0 +1,448 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * store_client.c and store.c change the aisles and the stockroom with plain
+ * reads and writes, so two checkout threads fulfilling orders at the same
+ * time can hand out the same item twice or lose a refill. This file is a
+ * version of the store whose operations may run from many threads at once,
+ * without a lock:
+ *
+ *   - Every aisle change is a 64-bit compare-and-swap of the whole aisle, as
+ *     in aisle_atomic.c. Taking items for an order computes the new aisle
+ *     from the value it read (removing items only from sections that still
+ *     hold the ordered id) and retries if another thread changed the aisle
+ *     first, so an item is never taken twice.
+ *   - Stockroom counters are only changed by reserving: a CAS loop takes
+ *     min(wanted, available) items, so the count never goes negative and an
+ *     order never draws more than is there.
+ *   - The aisles are split into contiguous shards. Each shard counts the
+ *     items of every id on its shelves, so an order skips shards that have
+ *     none, and each thread starts its orders in its own home shard so
+ *     threads mostly work on different cache lines. The counters are updated
+ *     right after each aisle CAS and are only used as hints.
+ *   - A full refill runs the shards in parallel in two passes. The first
+ *     counts how many items of each id every shard could take. The stock is
+ *     then reserved and handed out to the shards in address order, so lower
+ *     addresses still get priority, and the second pass fills every shard
+ *     with its share. Whatever a shard could not use (because orders changed
+ *     its sections in between) goes back to the stockroom.
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "aisle_manager.h"
+#include "store_concurrent.h"
+
+// Number of spaces in a section
+#define NUM_SPACES 10
+
+// The spaces bits of all four sections of an aisle
+#define ALL_SPACES 0x03FF03FF03FF03FFUL
+
+// Maximum number of refill threads
+#define MAX_THREADS 64
+
+struct shard {
+  size_t begin;                       // first aisle of the shard
+  size_t end;                         // one past its last aisle
+  long items[STORE_NUM_ITEMS];        // items of each id on its shelves
+} __attribute__((aligned(64)));
+
+struct store_concurrent {
+  unsigned long* aisles;
+  size_t num_aisles;
+  int num_shards;
+  struct shard* shards;
+  int stockroom[STORE_NUM_ITEMS];
+};
+
+// A pass over all shards, run by several threads
+struct shard_pass {
+  store_concurrent* s;
+  void (*fn)(store_concurrent* s, int shard, long* counts);
+  long* counts;                       // STORE_NUM_ITEMS per shard
+  int next;                           // next shard to claim
+};
+
+
+store_concurrent* store_concurrent_create(size_t num_aisles, int num_shards) {
+  store_concurrent* s;
+  size_t shard_size;
+
+  if (num_aisles == 0 || num_shards <= 0) {
+    return NULL;
+  }
+  s = calloc(1, sizeof(*s));
+  if (s == NULL) {
+    return NULL;
+  }
+  s->aisles = calloc(num_aisles, sizeof(unsigned long));
+  shard_size = (num_aisles + (size_t) num_shards - 1) / (size_t) num_shards;
+  s->num_shards = (int)((num_aisles + shard_size - 1) / shard_size);
+  if (posix_memalign((void**) &s->shards, 64,
+                     sizeof(struct shard) * (size_t) s->num_shards) != 0) {
+    s->shards = NULL;
+  }
+  if (s->aisles == NULL || s->shards == NULL) {
+    store_concurrent_destroy(s);
+    return NULL;
+  }
+  s->num_aisles = num_aisles;
+  for (int k = 0; k < s->num_shards; k++) {
+    struct shard* sh = &s->shards[k];
+    sh->begin = (size_t) k * shard_size;
+    sh->end = sh->begin + shard_size < num_aisles ? sh->begin + shard_size
+                                                  : num_aisles;
+    for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+      sh->items[id] = 0;
+    }
+  }
+  return s;
+}
+
+void store_concurrent_destroy(store_concurrent* s) {
+  if (s == NULL) {
+    return;
+  }
+  free(s->shards);
+  free(s->aisles);
+  free(s);
+}
+
+size_t store_concurrent_num_aisles(const store_concurrent* s) {
+  return s->num_aisles;
+}
+
+int store_concurrent_num_shards(const store_concurrent* s) {
+  return s->num_shards;
+}
+
+const unsigned long* store_concurrent_aisles(const store_concurrent* s) {
+  return s->aisles;
+}
+
+
+/* Returns the shard that aisle i belongs to. */
+static struct shard* shard_of(store_concurrent* s, size_t i) {
+  size_t shard_size = s->shards[0].end;
+  return &s->shards[i / shard_size];
+}
+
+/* Adds sign times the items in each section of aisle to the counts of its
+ * shard. */
+static void count_items(struct shard* sh, unsigned long aisle, int sign) {
+  for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+    int items = num_items(&aisle, j);
+    if (items > 0) {
+      __atomic_fetch_add(&sh->items[get_id(&aisle, j)], sign * items,
+                         __ATOMIC_RELAXED);
+    }
+  }
+}
+
+void store_concurrent_set_aisle(store_concurrent* s, size_t i,
+                                unsigned long aisle) {
+  unsigned long prev;
+  struct shard* sh;
+
+  if (i >= s->num_aisles) {
+    return;
+  }
+  sh = shard_of(s, i);
+  prev = __atomic_exchange_n(&s->aisles[i], aisle, __ATOMIC_ACQ_REL);
+  count_items(sh, prev, -1);
+  count_items(sh, aisle, 1);
+}
+
+
+int store_concurrent_get_stock(const store_concurrent* s, unsigned short id) {
+  return id < STORE_NUM_ITEMS
+      ? __atomic_load_n(&s->stockroom[id], __ATOMIC_RELAXED) : 0;
+}
+
+void store_concurrent_set_stock(store_concurrent* s, unsigned short id,
+                                int count) {
+  if (id < STORE_NUM_ITEMS) {
+    __atomic_store_n(&s->stockroom[id], count, __ATOMIC_RELEASE);
+  }
+}
+
+void store_concurrent_add_stock(store_concurrent* s, unsigned short id,
+                                int count) {
+  if (id < STORE_NUM_ITEMS && count != 0) {
+    __atomic_fetch_add(&s->stockroom[id], count, __ATOMIC_ACQ_REL);
+  }
+}
+
+/*
+ * take_stock - Reserves at most want items with the given id from the
+ *     stockroom and returns how many were reserved. Never takes the count
+ *     below zero, however many threads call it at once.
+ */
+static int take_stock(store_concurrent* s, unsigned short id, int want) {
+  int have = __atomic_load_n(&s->stockroom[id], __ATOMIC_RELAXED);
+  int take;
+
+  do {
+    if (have <= 0 || want <= 0) {
+      return 0;
+    }
+    take = have < want ? have : want;
+  } while (!__atomic_compare_exchange_n(&s->stockroom[id], &have, have - take,
+                                        1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  return take;
+}
+
+long store_concurrent_shelf_items(const store_concurrent* s, unsigned short id) {
+  long total = 0;
+
+  if (id >= STORE_NUM_ITEMS) {
+    return 0;
+  }
+  for (int k = 0; k < s->num_shards; k++) {
+    total += __atomic_load_n(&s->shards[k].items[id], __ATOMIC_RELAXED);
+  }
+  return total;
+}
+
+
+/*
+ * take_from_aisle - Atomically removes at most want items with the given id
+ *     from aisle i, lower sections first, and returns how many were removed.
+ */
+static int take_from_aisle(store_concurrent* s, struct shard* sh, size_t i,
+                           unsigned short id, int want) {
+  unsigned long* aisle = &s->aisles[i];
+  unsigned long prev = __atomic_load_n(aisle, __ATOMIC_RELAXED);
+  unsigned long next;
+  int taken;
+
+  do {
+    next = prev;
+    taken = 0;
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE && taken < want; j++) {
+      if (get_id(&next, j) == id) {
+        int num_to_remove = num_items(&next, j);
+        if (want - taken < num_to_remove) {
+          num_to_remove = want - taken;
+        }
+        if (num_to_remove > 0) {
+          remove_items(&next, j, num_to_remove);
+          taken += num_to_remove;
+        }
+      }
+    }
+    if (taken == 0) {
+      return 0;
+    }
+  } while (!__atomic_compare_exchange_n(aisle, &prev, next, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  __atomic_fetch_sub(&sh->items[id], taken, __ATOMIC_RELAXED);
+  return taken;
+}
+
+int store_concurrent_fulfill_order(store_concurrent* s, unsigned short id,
+                                   int num, int home_shard) {
+  int items_removed = 0;
+  int first;
+
+  if (id >= STORE_NUM_ITEMS || num <= 0) {
+    return 0;
+  }
+  first = home_shard % s->num_shards;
+  if (first < 0) {
+    first += s->num_shards;
+  }
+
+  for (int n = 0; n < s->num_shards && items_removed < num; n++) {
+    struct shard* sh = &s->shards[(first + n) % s->num_shards];
+    if (__atomic_load_n(&sh->items[id], __ATOMIC_RELAXED) <= 0) {
+      continue;  // nothing of this id on the shard's shelves
+    }
+    for (size_t i = sh->begin; i < sh->end && items_removed < num; i++) {
+      items_removed += take_from_aisle(s, sh, i, id, num - items_removed);
+    }
+  }
+
+  // Take whatever is still missing from the stockroom, if it has it
+  return items_removed + take_stock(s, id, num - items_removed);
+}
+
+
+/*
+ * fill_section - Atomically adds at most want items with the given id to
+ *     section j of aisle i, if the section still holds that id. Returns how
+ *     many were added.
+ */
+static int fill_section(store_concurrent* s, struct shard* sh, size_t i,
+                        int j, unsigned short id, int want) {
+  unsigned long* aisle = &s->aisles[i];
+  unsigned long prev = __atomic_load_n(aisle, __ATOMIC_RELAXED);
+  unsigned long next;
+  int added;
+
+  do {
+    next = prev;
+    if (get_id(&next, j) != id) {
+      return 0;
+    }
+    added = NUM_SPACES - num_items(&next, j);
+    if (want < added) {
+      added = want;
+    }
+    if (added <= 0) {
+      return 0;
+    }
+    add_items(&next, j, added);
+  } while (!__atomic_compare_exchange_n(aisle, &prev, next, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+  __atomic_fetch_add(&sh->items[id], added, __ATOMIC_RELAXED);
+  return added;
+}
+
+/*
+ * refill_shard - Refills the sections of one shard, lower addresses first.
+ *     Takes the items from budget (STORE_NUM_ITEMS counts reserved for this
+ *     shard beforehand, returning what is left to the stockroom), or straight
+ *     from the stockroom if budget is NULL.
+ */
+static void refill_shard(store_concurrent* s, int shard, long* budget) {
+  struct shard* sh = &s->shards[shard];
+
+  for (size_t i = sh->begin; i < sh->end; i++) {
+    unsigned long aisle = __atomic_load_n(&s->aisles[i], __ATOMIC_RELAXED);
+    if ((aisle & ALL_SPACES) == ALL_SPACES) {
+      continue;  // every section is already full
+    }
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      unsigned short id = get_id(&aisle, j);
+      int want = NUM_SPACES - num_items(&aisle, j);
+      int added;
+      if (want == 0) {
+        continue;
+      }
+      if (budget != NULL) {
+        want = budget[id] < want ? (int) budget[id] : want;
+      } else {
+        want = take_stock(s, id, want);
+      }
+      if (want == 0) {
+        continue;
+      }
+      added = fill_section(s, sh, i, j, id, want);
+      if (budget != NULL) {
+        budget[id] -= added;
+      } else {
+        store_concurrent_add_stock(s, id, want - added);
+      }
+    }
+  }
+
+  if (budget != NULL) {
+    for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+      store_concurrent_add_stock(s, (unsigned short) id, (int) budget[id]);
+    }
+  }
+}
+
+void store_concurrent_refill_shard(store_concurrent* s, int shard) {
+  if (shard >= 0 && shard < s->num_shards) {
+    refill_shard(s, shard, NULL);
+  }
+}
+
+/* Counts how many items of each id the sections of a shard have room for. */
+static void shard_demand(store_concurrent* s, int shard, long* demand) {
+  struct shard* sh = &s->shards[shard];
+
+  for (size_t i = sh->begin; i < sh->end; i++) {
+    unsigned long aisle = __atomic_load_n(&s->aisles[i], __ATOMIC_RELAXED);
+    if ((aisle & ALL_SPACES) == ALL_SPACES) {
+      continue;
+    }
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      demand[get_id(&aisle, j)] += NUM_SPACES - num_items(&aisle, j);
+    }
+  }
+}
+
+static void* pass_worker(void* arg) {
+  struct shard_pass* pass = arg;
+  int k;
+
+  while ((k = __atomic_fetch_add(&pass->next, 1, __ATOMIC_RELAXED)) <
+         pass->s->num_shards) {
+    pass->fn(pass->s, k, pass->counts + (size_t) k * STORE_NUM_ITEMS);
+  }
+  return NULL;
+}
+
+/* Runs fn on every shard (with that shard's row of counts), spread over up
+ * to num_threads threads including the calling one. */
+static void run_pass(store_concurrent* s, int num_threads,
+                     void (*fn)(store_concurrent*, int, long*), long* counts) {
+  pthread_t threads[MAX_THREADS];
+  struct shard_pass pass = {s, fn, counts, 0};
+  int started = 0;
+
+  if (num_threads > s->num_shards) {
+    num_threads = s->num_shards;
+  }
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+  for (int t = 1; t < num_threads; t++) {
+    if (pthread_create(&threads[started], NULL, pass_worker, &pass) != 0) {
+      break;
+    }
+    started++;
+  }
+  pass_worker(&pass);
+  for (int t = 0; t < started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+}
+
+void store_concurrent_refill_from_stockroom(store_concurrent* s,
+                                            int num_threads) {
+  long* counts = calloc((size_t) s->num_shards * STORE_NUM_ITEMS, sizeof(long));
+
+  if (counts == NULL) {
+    // Still refill, just without the parallel passes
+    for (int k = 0; k < s->num_shards; k++) {
+      refill_shard(s, k, NULL);
+    }
+    return;
+  }
+
+  // Pass 1: what every shard has room for
+  run_pass(s, num_threads, shard_demand, counts);
+
+  // Reserve the stock and turn the demands into budgets in address order
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    long total = 0;
+    long available;
+    for (int k = 0; k < s->num_shards; k++) {
+      total += counts[(size_t) k * STORE_NUM_ITEMS + id];
+    }
+    available = take_stock(s, (unsigned short) id,
+                           total < INT_MAX ? (int) total : INT_MAX);
+    for (int k = 0; k < s->num_shards; k++) {
+      long* budget = &counts[(size_t) k * STORE_NUM_ITEMS + id];
+      if (*budget > available) {
+        *budget = available;
+      }
+      available -= *budget;
+    }
+    store_concurrent_add_stock(s, (unsigned short) id, (int) available);
+  }
+
+  // Pass 2: every shard fills its sections from its budget
+  run_pass(s, num_threads, refill_shard, counts);
+  free(counts);
+}
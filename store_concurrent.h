@@ -0,0 +1,67 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * A store whose orders and refills can run from many threads at once. See
+ * store_concurrent.c for details.
+ */
+
+#ifndef STORE_CONCURRENT_H
+#define STORE_CONCURRENT_H
+
+#include <stddef.h>
+
+#include "store.h"
+
+typedef struct store_concurrent store_concurrent;
+
+/* Creates a store with num_aisles empty aisles split into (at most)
+ * num_shards contiguous shards, and an empty stockroom. Returns NULL if
+ * num_aisles or num_shards is not positive or memory runs out. */
+store_concurrent* store_concurrent_create(size_t num_aisles, int num_shards);
+
+/* Frees a store created by store_concurrent_create. No other thread may be
+ * using it. */
+void store_concurrent_destroy(store_concurrent* s);
+
+/* Returns the number of aisles / shards in the store. */
+size_t store_concurrent_num_aisles(const store_concurrent* s);
+int store_concurrent_num_shards(const store_concurrent* s);
+
+/* Returns the store's aisles. They must only be modified through the
+ * store_concurrent_ functions below. */
+const unsigned long* store_concurrent_aisles(const store_concurrent* s);
+
+/* Atomically replaces aisle i with the given bit pattern. */
+void store_concurrent_set_aisle(store_concurrent* s, size_t i,
+                                unsigned long aisle);
+
+/* Returns / sets / adds to the number of items with the given id in the
+ * stockroom. */
+int store_concurrent_get_stock(const store_concurrent* s, unsigned short id);
+void store_concurrent_set_stock(store_concurrent* s, unsigned short id,
+                                int count);
+void store_concurrent_add_stock(store_concurrent* s, unsigned short id,
+                                int count);
+
+/* Returns the number of items with the given id on the shelves of all
+ * aisles. Exact only when no update is running. */
+long store_concurrent_shelf_items(const store_concurrent* s, unsigned short id);
+
+/* Removes at most num items with the given id from the aisles, starting with
+ * shard home_shard (modulo the number of shards) and going on through the
+ * others, then from the stockroom, and returns the number removed. Safe to
+ * call from any number of threads; a thread that calls it with its own home
+ * shard mostly avoids contending with the others. */
+int store_concurrent_fulfill_order(store_concurrent* s, unsigned short id,
+                                   int num, int home_shard);
+
+/* Refills sections from the stockroom like refill_from_stockroom in
+ * store_client.c, using up to num_threads threads. When no order runs at the
+ * same time the result is the same as refilling one aisle after another. */
+void store_concurrent_refill_from_stockroom(store_concurrent* s,
+                                            int num_threads);
+
+/* Refills only the sections of one shard, lower addresses first. */
+void store_concurrent_refill_shard(store_concurrent* s, int shard);
+
+#endif
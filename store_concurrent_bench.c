@@ -0,0 +1,196 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Orders/sec benchmark for store_concurrent.c. Builds a store with random
+ * section ids, fills it from the stockroom, then lets each of 1, 2, 4, ...
+ * threads fulfill random orders (random id, 1 to 5 items) from its own home
+ * shard, refilling that shard every REFILL_EVERY orders. After every run it
+ * checks that no item was created or lost: the items on the shelves and in
+ * the stockroom at the end, plus all items handed out, must equal what was
+ * there at the start plus nothing.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -pthread -o store_concurrent_bench \
+ *       store_concurrent_bench.c store_concurrent.c aisle_manager.c
+ *
+ * Usage:
+ *   ./store_concurrent_bench [-a aisles] [-n orders] [-t max_threads]
+ *                            [-s shards]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "store_concurrent.h"
+
+// Maximum number of threads
+#define MAX_THREADS 256
+
+// Orders a thread fulfills between refills of its home shard
+#define REFILL_EVERY 64
+
+// Number of different ids used for sections and orders
+#define NUM_IDS 16
+
+// Items of each id in the stockroom at the start of a run
+#define INITIAL_STOCK 100000000
+
+struct worker_arg {
+  store_concurrent* s;
+  int thread;
+  long orders;
+  long items;                         // items this thread handed out
+};
+
+
+/* Returns a random number from a simple per-thread xorshift generator. */
+static unsigned next_random(unsigned long* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return (unsigned)(*state >> 32);
+}
+
+static void* worker(void* arg) {
+  struct worker_arg* w = arg;
+  unsigned long state = 0x9E3779B97F4A7C15UL * (unsigned long)(w->thread + 1);
+  int home = w->thread;
+
+  w->items = 0;
+  for (long i = 0; i < w->orders; i++) {
+    unsigned r = next_random(&state);
+    w->items += store_concurrent_fulfill_order(w->s, (unsigned short)(r % NUM_IDS),
+                                               1 + (int)((r >> 8) % 5), home);
+    if (i % REFILL_EVERY == REFILL_EVERY - 1) {
+      store_concurrent_refill_shard(w->s, home % store_concurrent_num_shards(w->s));
+    }
+  }
+  return NULL;
+}
+
+
+/* Returns the items on the shelves and in the stockroom of s. */
+static long total_items(store_concurrent* s) {
+  long total = 0;
+  for (unsigned short id = 0; id < NUM_IDS; id++) {
+    total += store_concurrent_shelf_items(s, id) + store_concurrent_get_stock(s, id);
+  }
+  return total;
+}
+
+/*
+ * setup - Creates a store with random ids in every section, filled from an
+ *     INITIAL_STOCK stockroom.
+ */
+static store_concurrent* setup(size_t num_aisles, int num_shards) {
+  store_concurrent* s = store_concurrent_create(num_aisles, num_shards);
+  unsigned long state = 12345;
+
+  if (s == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < num_aisles; i++) {
+    unsigned long aisle = 0;
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      aisle |= (unsigned long)(next_random(&state) % NUM_IDS) << (16 * j + 10);
+    }
+    store_concurrent_set_aisle(s, i, aisle);
+  }
+  for (unsigned short id = 0; id < NUM_IDS; id++) {
+    store_concurrent_set_stock(s, id, INITIAL_STOCK);
+  }
+  store_concurrent_refill_from_stockroom(s, (int) sysconf(_SC_NPROCESSORS_ONLN));
+  return s;
+}
+
+
+int main(int argc, char* argv[]) {
+  size_t num_aisles = 1 << 16;
+  long orders = 1000000;
+  int max_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  int num_shards = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:n:t:s:h")) != -1) {
+    switch (opt) {
+      case 'a':
+        num_aisles = (size_t) atol(optarg);
+        break;
+      case 'n':
+        orders = atol(optarg);
+        break;
+      case 't':
+        max_threads = atoi(optarg);
+        break;
+      case 's':
+        num_shards = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-a aisles] [-n orders] [-t max_threads]"
+                " [-s shards]\n", argv[0]);
+        fprintf(stderr, "\t-n\torders per thread\n");
+        fprintf(stderr, "\t-s\tshards (default: 4 per thread)\n");
+        return EXIT_FAILURE;
+    }
+  }
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+  if (max_threads > MAX_THREADS) {
+    max_threads = MAX_THREADS;
+  }
+  if (num_shards <= 0) {
+    num_shards = 4 * max_threads;
+  }
+
+  printf("%zu aisles, %d shards, %ld orders per thread\n", num_aisles,
+         num_shards, orders);
+  printf("%8s %14s %10s %s\n", "threads", "orders/s", "speedup", "result");
+  double base = 0;
+  // Powers of two up to max_threads, and max_threads itself
+  for (int n = 1;; n = 2 * n < max_threads ? 2 * n : max_threads) {
+    pthread_t threads[MAX_THREADS];
+    struct worker_arg args[MAX_THREADS];
+    store_concurrent* s = setup(num_aisles, num_shards);
+    long before = total_items(s);
+    long handed_out = 0;
+    struct timespec start, end;
+    double seconds, rate;
+    int started = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < n; t++) {
+      args[t].s = s;
+      args[t].thread = t;
+      args[t].orders = orders;
+      if (pthread_create(&threads[t], NULL, worker, &args[t]) != 0) {
+        break;
+      }
+      started++;
+    }
+    for (int t = 0; t < started; t++) {
+      pthread_join(threads[t], NULL);
+      handed_out += args[t].items;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    rate = (double) started * orders / seconds;
+    if (n == 1) {
+      base = rate;
+    }
+    printf("%8d %14.0f %9.2fx %s\n", started, rate, rate / base,
+           total_items(s) + handed_out == before ? "ok" : "ITEMS LOST");
+    store_concurrent_destroy(s);
+    if (n == max_threads) {
+      break;
+    }
+  }
+  return EXIT_SUCCESS;
+}
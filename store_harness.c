@@ -0,0 +1,1846 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Fuzz and benchmark driver for every implementation of the aisle and store
+ * operations.
+ *
+ * The reference model below keeps each section as an id and an array of
+ * spaces (ten, or however many the layout has) and does exactly what the
+ * comments in aisle_manager.c and store_client.c say, one space at a time,
+ * so it is easy to check by hand. The fuzzer compares every other
+ * implementation against it:
+ *
+ *   - aisle level: aisle_manager.c, aisle_atomic.c (also checking the counts
+ *     it returns), and aisle_batch.c's op lists and range functions, on
+ *     random aisles with item counts from below 0 to past 10, and every
+ *     layout of aisle_layout.h the same way. Every remove_items call whose n
+ *     is at least the number of items checks the full-clear case.
+ *   - store level: store.c (with store_fulfill_batch, the shelf totals,
+ *     store_can_fill and attached store_analytics statistics),
+ *     store_concurrent.c on one thread, and store_client.c when the store
+ *     has its NUM_AISLES aisles, all running the same random workload. The
+ *     result of every operation is compared, and the aisles and stockroom
+ *     every CHECK_EVERY operations and at the end.
+ *
+ * The log mode checks store_log.c's crash recovery: commit, snapshot and
+ * recover round trips, a log whose last batch was cut off, a crash between
+ * a snapshot and emptying the log, damaged snapshots, and a commit that
+ * fails. See test_log below. It also checks a store file with a writer and
+ * read-only stores in the same and in another process (test_shared_file).
+ *
+ * The registry mode runs the workload through store_registry.c's indexed and
+ * compact stores against the model, and checks registry_run on several
+ * threads against running the same jobs one at a time.
+ *
+ * The workload is what a store sees: mostly small orders for a few popular
+ * ids, some bulk orders that run into the stockroom, restocks followed by
+ * refills, sections relabeled for another id, and queries. Stock never goes
+ * negative, which is the only case where store_client.c and store.c are
+ * allowed to differ.
+ *
+ * The benchmark runs the same workload against each store implementation
+ * and reports, per kind of operation, operations per second and latency
+ * percentiles. Every operation is timed on its own, so the numbers include
+ * about 20-30 ns of clock_gettime overhead.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -pthread -o store_harness store_harness.c store.c \
+ *       store_log.c store_query.c store_analytics.c store_concurrent.c \
+ *       store_registry.c store_client.c aisle_manager.c aisle_atomic.c \
+ *       aisle_batch.c bitset.c
+ *
+ * Usage:
+ *   ./store_harness [-a aisles] [-n ops] [-r seed]
+ *                   [-m fuzz|log|registry|bench|all]
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "aisle_atomic.h"
+#include "aisle_batch.h"
+#include "aisle_layout.h"
+#include "aisle_manager.h"
+#include "store.h"
+#include "store_analytics.h"
+#include "store_client.h"
+#include "store_concurrent.h"
+#include "store_log.h"
+#include "store_query.h"
+#include "store_registry.h"
+
+// Number of spaces in a section
+#define NUM_SPACES 10
+
+// Most spaces in a section of any aisle_layout.h layout
+#define MAX_SPACES 32
+
+// Number of aisles in store_client.c's store (its NUM_AISLES)
+#define CLIENT_AISLES 10
+
+// Operations between full comparisons of the store states
+#define CHECK_EVERY 256
+
+// Most orders in one batch
+#define MAX_BATCH 64
+
+// store_client.c's store
+extern unsigned long aisles[];
+extern int stockroom[];
+
+
+/* Returns a random number from a xorshift generator. */
+static unsigned next_random(unsigned long* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return (unsigned)(*state >> 32);
+}
+
+/* Returns a random item id, one of the 8 popular ones 80% of the time. */
+static unsigned short random_id(unsigned long* state) {
+  unsigned r = next_random(state);
+  return (unsigned short)(r % 100 < 80 ? (r >> 8) % 8 : (r >> 8) % STORE_NUM_ITEMS);
+}
+
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Reference model
+ * ----------------------------------------------------------------------------
+ */
+
+struct ref_section {
+  int id;
+  int id_bits;                        // width of the id field
+  int num_spaces;                     // spaces in the section
+  int full[MAX_SPACES];               // 1 if the space holds an item
+};
+
+static int ref_count(const struct ref_section* sec) {
+  int count = 0;
+  for (int k = 0; k < sec->num_spaces; k++) {
+    count += sec->full[k];
+  }
+  return count;
+}
+
+/* Fills the lowest empty spaces, at most n of them. Returns how many. */
+static int ref_add_items(struct ref_section* sec, int n) {
+  int added = 0;
+  for (int k = 0; k < sec->num_spaces && added < n; k++) {
+    if (!sec->full[k]) {
+      sec->full[k] = 1;
+      added++;
+    }
+  }
+  return added;
+}
+
+/* Empties the lowest full spaces, at most n of them, so n at least the count
+ * clears the section. Returns how many. */
+static int ref_remove_items(struct ref_section* sec, int n) {
+  int removed = 0;
+  for (int k = 0; k < sec->num_spaces && removed < n; k++) {
+    if (sec->full[k]) {
+      sec->full[k] = 0;
+      removed++;
+    }
+  }
+  return removed;
+}
+
+/* Moves the item in space k to space k + n, wrapping around. */
+static void ref_rotate_left(struct ref_section* sec, int n) {
+  int old[MAX_SPACES];
+  int size = sec->num_spaces;
+  memcpy(old, sec->full, sizeof(old));
+  for (int k = 0; k < size; k++) {
+    sec->full[((k + n) % size + size) % size] = old[k];
+  }
+}
+
+static void ref_set_id(struct ref_section* sec, int id) {
+  if (id >= 0 && id < (1 << sec->id_bits)) {
+    sec->id = id;
+  }
+}
+
+/* Converts between the model's sections and a word of any aisle_layout.h
+ * layout, held as 64-bit pieces with the lowest first. */
+static void ref_from_words(struct ref_section* secs, int num_sections,
+                           int id_bits, int num_spaces, const uint64_t* words) {
+  for (int j = 0; j < num_sections; j++) {
+    int base = (id_bits + num_spaces) * j;
+    secs[j].id = 0;
+    secs[j].id_bits = id_bits;
+    secs[j].num_spaces = num_spaces;
+    for (int k = 0; k < num_spaces + id_bits; k++) {
+      int bit = (int)(words[(base + k) / 64] >> ((base + k) % 64)) & 1;
+      if (k < num_spaces) {
+        secs[j].full[k] = bit;
+      } else {
+        secs[j].id |= bit << (k - num_spaces);
+      }
+    }
+  }
+}
+
+static void ref_to_words(const struct ref_section* secs, int num_sections,
+                         int num_words, uint64_t* words) {
+  memset(words, 0, (size_t) num_words * sizeof(uint64_t));
+  for (int j = 0; j < num_sections; j++) {
+    int base = (secs[j].id_bits + secs[j].num_spaces) * j;
+    for (int k = 0; k < secs[j].num_spaces + secs[j].id_bits; k++) {
+      uint64_t bit = k < secs[j].num_spaces
+                         ? (uint64_t) secs[j].full[k]
+                         : (uint64_t)(secs[j].id >> (k - secs[j].num_spaces)) & 1;
+      words[(base + k) / 64] |= bit << ((base + k) % 64);
+    }
+  }
+}
+
+/* The same for the aisle_manager.c layout. */
+static void ref_from_aisle(struct ref_section* secs, unsigned long aisle) {
+  uint64_t word = aisle;
+  ref_from_words(secs, STORE_SECTIONS_PER_AISLE, 6, NUM_SPACES, &word);
+}
+
+static unsigned long ref_to_aisle(const struct ref_section* secs) {
+  uint64_t word;
+  ref_to_words(secs, STORE_SECTIONS_PER_AISLE, 1, &word);
+  return (unsigned long) word;
+}
+
+struct ref_store {
+  size_t num_aisles;
+  struct ref_section* sections;       // num_aisles * 4, in address order
+  int stock[STORE_NUM_ITEMS];
+};
+
+static void ref_refill(struct ref_store* r) {
+  for (size_t i = 0; i < r->num_aisles * STORE_SECTIONS_PER_AISLE; i++) {
+    struct ref_section* sec = &r->sections[i];
+    int room = NUM_SPACES - ref_count(sec);
+    int take = r->stock[sec->id] < room ? r->stock[sec->id] : room;
+    if (take > 0) {
+      r->stock[sec->id] -= ref_add_items(sec, take);
+    }
+  }
+}
+
+static int ref_fulfill(struct ref_store* r, unsigned short id, int num) {
+  int removed = 0;
+  for (size_t i = 0; i < r->num_aisles * STORE_SECTIONS_PER_AISLE; i++) {
+    if (r->sections[i].id == id && removed < num) {
+      removed += ref_remove_items(&r->sections[i], num - removed);
+    }
+  }
+  if (removed < num && r->stock[id] > 0) {
+    int take = num - removed < r->stock[id] ? num - removed : r->stock[id];
+    r->stock[id] -= take;
+    removed += take;
+  }
+  return removed;
+}
+
+static long ref_empty_section(struct ref_store* r, unsigned short id) {
+  for (size_t i = 0; i < r->num_aisles * STORE_SECTIONS_PER_AISLE; i++) {
+    if (r->sections[i].id == id && ref_count(&r->sections[i]) == 0) {
+      return (long) i;
+    }
+  }
+  return -1;
+}
+
+static long ref_most_items(struct ref_store* r) {
+  long best = 0;
+  for (size_t i = 1; i < r->num_aisles * STORE_SECTIONS_PER_AISLE; i++) {
+    if (ref_count(&r->sections[i]) > ref_count(&r->sections[best])) {
+      best = (long) i;
+    }
+  }
+  return best;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Store implementations
+ * ----------------------------------------------------------------------------
+ *
+ * Each implementation is driven through a table of functions. Sections are
+ * reported by position (aisle * 4 + section), -1 for none.
+ */
+
+struct variant {
+  const char* name;
+  size_t fixed_aisles;                // only runs with this many, or 0 for any
+  void* (*create)(size_t num_aisles);
+  void (*destroy)(void* v);
+  unsigned long (*get_aisle)(void* v, size_t i);
+  void (*set_aisle)(void* v, size_t i, unsigned long aisle);
+  int (*get_stock)(void* v, unsigned short id);
+  void (*set_stock)(void* v, unsigned short id, int count);
+  void (*refill)(void* v);
+  int (*fulfill)(void* v, unsigned short id, int num);
+  long (*fulfill_batch)(void* v, const struct store_order* orders,
+                        size_t count, int* filled);  // NULL: one at a time
+  long (*empty_section)(void* v, unsigned short id);
+  long (*most_items)(void* v);
+};
+
+/* Returns the position of a section pointer into aisle_array, or -1. */
+static long position(const unsigned long* aisle_array, unsigned short* section) {
+  return section == NULL ? -1 : (long)(section - (unsigned short*) aisle_array);
+}
+
+static void* ref_create(size_t num_aisles) {
+  struct ref_store* r = calloc(1, sizeof(*r));
+  if (r == NULL) {
+    return NULL;
+  }
+  r->num_aisles = num_aisles;
+  r->sections = calloc(num_aisles * STORE_SECTIONS_PER_AISLE, sizeof(struct ref_section));
+  if (r->sections == NULL) {
+    free(r);
+    return NULL;
+  }
+  for (size_t i = 0; i < num_aisles; i++) {
+    ref_from_aisle(&r->sections[i * STORE_SECTIONS_PER_AISLE], 0);
+  }
+  return r;
+}
+
+static void ref_destroy(void* v) {
+  struct ref_store* r = v;
+  free(r->sections);
+  free(r);
+}
+
+static unsigned long ref_get_aisle(void* v, size_t i) {
+  return ref_to_aisle(&((struct ref_store*) v)->sections[i * STORE_SECTIONS_PER_AISLE]);
+}
+
+static void ref_set_aisle(void* v, size_t i, unsigned long aisle) {
+  ref_from_aisle(&((struct ref_store*) v)->sections[i * STORE_SECTIONS_PER_AISLE], aisle);
+}
+
+static int ref_get_stock(void* v, unsigned short id) {
+  return ((struct ref_store*) v)->stock[id];
+}
+
+static void ref_set_stock(void* v, unsigned short id, int count) {
+  ((struct ref_store*) v)->stock[id] = count;
+}
+
+static void ref_refill_v(void* v) { ref_refill(v); }
+static int ref_fulfill_v(void* v, unsigned short id, int num) { return ref_fulfill(v, id, num); }
+static long ref_empty_v(void* v, unsigned short id) { return ref_empty_section(v, id); }
+static long ref_most_v(void* v) { return ref_most_items(v); }
+
+static void* st_create(size_t num_aisles) { return store_create(num_aisles); }
+static void st_destroy(void* v) { store_destroy(v); }
+static unsigned long st_get_aisle(void* v, size_t i) { return store_aisles(v)[i]; }
+static void st_set_aisle(void* v, size_t i, unsigned long a) { store_set_aisle(v, i, a); }
+static int st_get_stock(void* v, unsigned short id) { return store_get_stock(v, id); }
+static void st_set_stock(void* v, unsigned short id, int c) { store_set_stock(v, id, c); }
+static void st_refill(void* v) { store_refill_from_stockroom(v); }
+static int st_fulfill(void* v, unsigned short id, int num) { return store_fulfill_order(v, id, num); }
+
+static long st_fulfill_batch(void* v, const struct store_order* orders,
+                             size_t count, int* filled) {
+  return store_fulfill_batch(v, orders, count, filled);
+}
+
+static long st_empty(void* v, unsigned short id) {
+  return position(store_aisles(v), store_empty_section_with_id(v, id));
+}
+
+static long st_most(void* v) {
+  return position(store_aisles(v), store_section_with_most_items(v));
+}
+
+static void* cc_create(size_t num_aisles) { return store_concurrent_create(num_aisles, 16); }
+static void cc_destroy(void* v) { store_concurrent_destroy(v); }
+static unsigned long cc_get_aisle(void* v, size_t i) { return store_concurrent_aisles(v)[i]; }
+static void cc_set_aisle(void* v, size_t i, unsigned long a) { store_concurrent_set_aisle(v, i, a); }
+static int cc_get_stock(void* v, unsigned short id) { return store_concurrent_get_stock(v, id); }
+static void cc_set_stock(void* v, unsigned short id, int c) { store_concurrent_set_stock(v, id, c); }
+static void cc_refill(void* v) { store_concurrent_refill_from_stockroom(v, 1); }
+static int cc_fulfill(void* v, unsigned short id, int num) { return store_concurrent_fulfill_order(v, id, num, 0); }
+
+static long cc_empty(void* v, unsigned short id) {
+  unsigned long* a = (unsigned long*) store_concurrent_aisles(v);
+  return position(a, bulk_empty_section_with_id(a, store_concurrent_num_aisles(v), id));
+}
+
+static long cc_most(void* v) {
+  unsigned long* a = (unsigned long*) store_concurrent_aisles(v);
+  return position(a, bulk_section_with_most_items(a, store_concurrent_num_aisles(v)));
+}
+
+// store_client.c has one global store, so only one client variant can exist
+static void* cl_create(size_t num_aisles) {
+  (void) num_aisles;
+  memset(aisles, 0, CLIENT_AISLES * sizeof(unsigned long));
+  memset(stockroom, 0, STORE_NUM_ITEMS * sizeof(int));
+  return aisles;
+}
+
+static void cl_destroy(void* v) { (void) v; }
+static unsigned long cl_get_aisle(void* v, size_t i) { (void) v; return aisles[i]; }
+static void cl_set_aisle(void* v, size_t i, unsigned long a) { (void) v; aisles[i] = a; }
+static int cl_get_stock(void* v, unsigned short id) { (void) v; return stockroom[id]; }
+static void cl_set_stock(void* v, unsigned short id, int c) { (void) v; stockroom[id] = c; }
+static void cl_refill(void* v) { (void) v; refill_from_stockroom(); }
+static int cl_fulfill(void* v, unsigned short id, int num) { (void) v; return fulfill_order(id, num); }
+static long cl_empty(void* v, unsigned short id) { (void) v; return position(aisles, empty_section_with_id(id)); }
+static long cl_most(void* v) { (void) v; return position(aisles, section_with_most_items()); }
+
+// A store in a registry of its own, run through the registry_ functions
+struct reg_handle {
+  store_registry* r;
+  int id;
+};
+
+static void* rg_create(size_t num_aisles, int flags) {
+  struct reg_handle* h = malloc(sizeof(*h));
+  if (h == NULL) {
+    return NULL;
+  }
+  h->r = registry_create(1);
+  h->id = h->r == NULL ? -1 : registry_add_store(h->r, num_aisles, flags);
+  if (h->id < 0) {
+    registry_destroy(h->r);
+    free(h);
+    return NULL;
+  }
+  return h;
+}
+
+static void* rg_create_indexed(size_t num_aisles) { return rg_create(num_aisles, 0); }
+static void* rg_create_compact(size_t num_aisles) { return rg_create(num_aisles, REGISTRY_COMPACT); }
+static void rg_destroy(void* v) {
+  struct reg_handle* h = v;
+  registry_destroy(h->r);
+  free(h);
+}
+static unsigned long rg_get_aisle(void* v, size_t i) {
+  struct reg_handle* h = v;
+  unsigned long aisle = 0;
+  registry_get_aisle(h->r, h->id, i, &aisle);
+  return aisle;
+}
+static void rg_set_aisle(void* v, size_t i, unsigned long a) {
+  struct reg_handle* h = v;
+  registry_set_aisle(h->r, h->id, i, a);
+}
+static int rg_get_stock(void* v, unsigned short id) {
+  struct reg_handle* h = v;
+  return registry_get_stock(h->r, h->id, id);
+}
+static void rg_set_stock(void* v, unsigned short id, int c) {
+  struct reg_handle* h = v;
+  registry_set_stock(h->r, h->id, id, c);
+}
+static void rg_refill(void* v) {
+  struct reg_handle* h = v;
+  registry_refill_from_stockroom(h->r, h->id);
+}
+static int rg_fulfill(void* v, unsigned short id, int num) {
+  struct reg_handle* h = v;
+  return registry_fulfill_order(h->r, h->id, id, num);
+}
+static long rg_empty(void* v, unsigned short id) {
+  struct reg_handle* h = v;
+  return registry_empty_section_with_id(h->r, h->id, id);
+}
+static long rg_most(void* v) {
+  struct reg_handle* h = v;
+  return registry_section_with_most_items(h->r, h->id);
+}
+
+static const struct variant reference = {
+  "reference", 0, ref_create, ref_destroy, ref_get_aisle, ref_set_aisle,
+  ref_get_stock, ref_set_stock, ref_refill_v, ref_fulfill_v, NULL,
+  ref_empty_v, ref_most_v
+};
+
+static const struct variant variants[] = {
+  {"store", 0, st_create, st_destroy, st_get_aisle, st_set_aisle,
+   st_get_stock, st_set_stock, st_refill, st_fulfill, st_fulfill_batch,
+   st_empty, st_most},
+  {"store_concurrent", 0, cc_create, cc_destroy, cc_get_aisle, cc_set_aisle,
+   cc_get_stock, cc_set_stock, cc_refill, cc_fulfill, NULL, cc_empty, cc_most},
+  {"store_client", CLIENT_AISLES, cl_create, cl_destroy, cl_get_aisle,
+   cl_set_aisle, cl_get_stock, cl_set_stock, cl_refill, cl_fulfill, NULL,
+   cl_empty, cl_most},
+};
+
+#define NUM_VARIANTS (int)(sizeof(variants) / sizeof(variants[0]))
+
+// The two kinds of registry store, checked by the registry mode
+static const struct variant registry_variants[] = {
+  {"registry indexed", 0, rg_create_indexed, rg_destroy, rg_get_aisle,
+   rg_set_aisle, rg_get_stock, rg_set_stock, rg_refill, rg_fulfill, NULL,
+   rg_empty, rg_most},
+  {"registry compact", 0, rg_create_compact, rg_destroy, rg_get_aisle,
+   rg_set_aisle, rg_get_stock, rg_set_stock, rg_refill, rg_fulfill, NULL,
+   rg_empty, rg_most},
+};
+
+#define NUM_REGISTRY_VARIANTS \
+  (int)(sizeof(registry_variants) / sizeof(registry_variants[0]))
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Workload
+ * ----------------------------------------------------------------------------
+ */
+
+enum op_kind {
+  OP_ORDER,           // fulfill_order(id, num)
+  OP_BATCH,           // num orders at once, generated from seed
+  OP_RESTOCK,         // num more items of id in the stockroom
+  OP_REFILL,          // refill_from_stockroom
+  OP_RELABEL,         // section of aisle emptied and given id
+  OP_EMPTY_QUERY,     // empty_section_with_id(id)
+  OP_MOST_QUERY,      // section_with_most_items
+  NUM_OP_KINDS
+};
+
+static const char* op_names[NUM_OP_KINDS] = {
+  "order", "batch", "restock", "refill", "relabel", "empty_query", "most_query"
+};
+
+// Percent of operations of each kind
+static const int op_weights[NUM_OP_KINDS] = {62, 4, 10, 4, 10, 5, 5};
+
+struct op {
+  enum op_kind kind;
+  unsigned short id;
+  int num;
+  int section;
+  size_t aisle;
+  unsigned long seed;
+};
+
+/* Fills ops[0..count) with a random workload for a store of num_aisles. */
+static void make_workload(struct op* ops, size_t count, size_t num_aisles,
+                          unsigned long* state) {
+  for (size_t k = 0; k < count; k++) {
+    struct op* op = &ops[k];
+    int r = (int)(next_random(state) % 100);
+    int kind = 0;
+    while (r >= op_weights[kind]) {
+      r -= op_weights[kind];
+      kind++;
+    }
+    op->kind = (enum op_kind) kind;
+    op->id = random_id(state);
+    op->aisle = next_random(state) % num_aisles;
+    op->section = (int)(next_random(state) % STORE_SECTIONS_PER_AISLE);
+    op->seed = next_random(state) | 1;
+    switch (op->kind) {
+      case OP_ORDER:
+        // Mostly 0 to 5 items, sometimes a bulk order
+        op->num = next_random(state) % 10 == 0 ? 20 + (int)(next_random(state) % 60)
+                                               : (int)(next_random(state) % 6);
+        break;
+      case OP_BATCH:
+        op->num = 1 + (int)(next_random(state) % MAX_BATCH);
+        break;
+      case OP_RESTOCK:
+        op->num = 1 + (int)(next_random(state) % 200);
+        break;
+      default:
+        op->num = 0;
+        break;
+    }
+  }
+}
+
+/* Generates the orders of a batch op. */
+static void make_batch(const struct op* op, struct store_order* orders) {
+  unsigned long state = op->seed;
+  for (int k = 0; k < op->num; k++) {
+    orders[k].id = random_id(&state);
+    orders[k].num = (int)(next_random(&state) % 8);
+  }
+}
+
+/*
+ * run_op - Runs op on v and returns its result (0 for operations without
+ *     one). Batches store each order's count in filled.
+ */
+static long run_op(const struct variant* var, void* v, const struct op* op,
+                   const struct store_order* orders, int* filled) {
+  switch (op->kind) {
+    case OP_ORDER:
+      return var->fulfill(v, op->id, op->num);
+    case OP_BATCH:
+      if (var->fulfill_batch != NULL) {
+        return var->fulfill_batch(v, orders, (size_t) op->num, filled);
+      } else {
+        long total = 0;
+        for (int k = 0; k < op->num; k++) {
+          filled[k] = var->fulfill(v, orders[k].id, orders[k].num);
+          total += filled[k];
+        }
+        return total;
+      }
+    case OP_RESTOCK:
+      var->set_stock(v, op->id, var->get_stock(v, op->id) + op->num);
+      return 0;
+    case OP_REFILL:
+      var->refill(v);
+      return 0;
+    case OP_RELABEL: {
+      unsigned long aisle = var->get_aisle(v, op->aisle);
+      unsigned long mask = 0xFFFFUL << (16 * op->section);
+      aisle = (aisle & ~mask) | ((unsigned long) op->id << (16 * op->section + NUM_SPACES));
+      var->set_aisle(v, op->aisle, aisle);
+      return 0;
+    }
+    case OP_EMPTY_QUERY:
+      return var->empty_section(v, op->id);
+    case OP_MOST_QUERY:
+      return var->most_items(v);
+    default:
+      return 0;
+  }
+}
+
+/* Gives every section of v a random id and fills it from a large stockroom,
+ * the same way for every variant. */
+static void setup(const struct variant* var, void* v, size_t num_aisles,
+                  unsigned long seed) {
+  unsigned long state = seed;
+  for (size_t i = 0; i < num_aisles; i++) {
+    unsigned long aisle = 0;
+    for (int j = 0; j < STORE_SECTIONS_PER_AISLE; j++) {
+      aisle |= (unsigned long) random_id(&state) << (16 * j + NUM_SPACES);
+    }
+    var->set_aisle(v, i, aisle);
+  }
+  for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+    var->set_stock(v, id, (int)(num_aisles * 24 / 8));
+  }
+  var->refill(v);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Fuzzing
+ * ----------------------------------------------------------------------------
+ */
+
+static long failures = 0;
+
+static void fail(const char* what, const char* detail, long k) {
+  if (failures++ < 20) {
+    fprintf(stderr, "MISMATCH %s: %s (case %ld)\n", what, detail, k);
+  }
+}
+
+/* Checks every aisle operation of every aisle implementation on one random
+ * aisle, section and n against the model. */
+static void fuzz_aisle_case(unsigned long* state, long k) {
+  struct ref_section secs[STORE_SECTIONS_PER_AISLE];
+  unsigned long aisle = ((unsigned long) next_random(state) << 32) | next_random(state);
+  int j = (int)(next_random(state) % STORE_SECTIONS_PER_AISLE);
+  int n = (int)(next_random(state) % 17) - 3;
+  int op = (int)(next_random(state) % 5);
+  int expect_moved = 0;
+  int moved = 0;
+  unsigned long plain, layout, atomic, batched, expect;
+  unsigned long range[3];
+  struct aisle_op ops[1];
+
+  // Empty and full sections, where the edge cases are
+  switch (next_random(state) % 4) {
+    case 0:
+      aisle &= ~(0x3FFUL << (16 * j));
+      break;
+    case 1:
+      aisle |= 0x3FFUL << (16 * j);
+      break;
+  }
+  plain = layout = atomic = batched = range[0] = range[1] = range[2] = aisle;
+  ref_from_aisle(secs, aisle);
+
+  switch (op) {
+    case 0:
+      expect_moved = ref_add_items(&secs[j], n);
+      add_items(&plain, j, n);
+      aisle64_add_items(&layout, j, n);
+      moved = atomic_add_items(&atomic, j, n);
+      ops[0].kind = AISLE_OP_ADD_ITEMS;
+      aisles_add_items(range, 3, j, n);
+      break;
+    case 1:
+      expect_moved = ref_remove_items(&secs[j], n);
+      remove_items(&plain, j, n);
+      aisle64_remove_items(&layout, j, n);
+      moved = atomic_remove_items(&atomic, j, n);
+      ops[0].kind = AISLE_OP_REMOVE_ITEMS;
+      aisles_remove_items(range, 3, j, n);
+      break;
+    case 2:
+      ref_rotate_left(&secs[j], n);
+      rotate_items_left(&plain, j, n);
+      aisle64_rotate_items_left(&layout, j, n);
+      atomic = ref_to_aisle(secs);  // no atomic rotate
+      ops[0].kind = AISLE_OP_ROTATE_LEFT;
+      aisles_rotate_left(range, 3, j, n);
+      break;
+    case 3:
+      ref_rotate_left(&secs[j], -n);
+      rotate_items_right(&plain, j, n);
+      aisle64_rotate_items_right(&layout, j, n);
+      atomic = ref_to_aisle(secs);
+      ops[0].kind = AISLE_OP_ROTATE_RIGHT;
+      aisles_rotate_right(range, 3, j, n);
+      break;
+    case 4:
+      n += 60;  // ids 57 to 73, some too wide
+      ref_set_id(&secs[j], n);
+      set_id(&plain, j, (unsigned short) n);
+      aisle64_set_id(&layout, j, (unsigned) n);
+      atomic_set_id(&atomic, j, (unsigned short) n);
+      ops[0].kind = AISLE_OP_SET_ID;
+      aisles_set_id(range, 3, j, (unsigned short) n);
+      break;
+  }
+  ops[0].aisle = &batched;
+  ops[0].section = j;
+  ops[0].arg = n;
+  aisle_apply_ops(ops, 1);
+
+  expect = ref_to_aisle(secs);
+  if (plain != expect) {
+    fail("aisle_manager", "aisle differs", k);
+  }
+  if (layout != expect) {
+    fail("aisle_layout aisle64", "aisle differs", k);
+  }
+  if (atomic != expect) {
+    fail("aisle_atomic", "aisle differs", k);
+  }
+  if (op < 2 && moved != expect_moved) {
+    fail("aisle_atomic", "wrong count returned", k);
+  }
+  if (batched != expect) {
+    fail("aisle_apply_ops", "aisle differs", k);
+  }
+  for (int i = 0; i < 3; i++) {
+    if (range[i] != expect) {
+      fail("aisle_batch range", "aisle differs", k);
+    }
+  }
+  if (num_items(&plain, j) != ref_count(&secs[j])) {
+    fail("num_items", "count differs", k);
+  }
+}
+
+/* Checks a random list of operations over a few aisles, applied with
+ * aisle_apply_ops, against applying each to the model in turn. */
+static void fuzz_op_list(unsigned long* state, long k) {
+  unsigned long list_aisles[4];
+  struct ref_section secs[4][STORE_SECTIONS_PER_AISLE];
+  struct aisle_op ops[32];
+  int count = 1 + (int)(next_random(state) % 32);
+
+  for (int i = 0; i < 4; i++) {
+    list_aisles[i] = ((unsigned long) next_random(state) << 32) | next_random(state);
+    ref_from_aisle(secs[i], list_aisles[i]);
+  }
+  for (int o = 0; o < count; o++) {
+    int i = (int)(next_random(state) % 4);
+    int j = (int)(next_random(state) % STORE_SECTIONS_PER_AISLE);
+    int n = (int)(next_random(state) % 17) - 3;
+    ops[o].aisle = &list_aisles[i];
+    ops[o].section = j;
+    ops[o].arg = n;
+    switch (next_random(state) % 5) {
+      case 0:
+        ops[o].kind = AISLE_OP_ADD_ITEMS;
+        ref_add_items(&secs[i][j], n);
+        break;
+      case 1:
+        ops[o].kind = AISLE_OP_REMOVE_ITEMS;
+        ref_remove_items(&secs[i][j], n);
+        break;
+      case 2:
+        ops[o].kind = AISLE_OP_ROTATE_LEFT;
+        ref_rotate_left(&secs[i][j], n);
+        break;
+      case 3:
+        ops[o].kind = AISLE_OP_ROTATE_RIGHT;
+        ref_rotate_left(&secs[i][j], -n);
+        break;
+      default:
+        ops[o].kind = AISLE_OP_SET_ID;
+        ops[o].arg = n + 60;
+        ref_set_id(&secs[i][j], n + 60);
+        break;
+    }
+  }
+  aisle_apply_ops(ops, (size_t) count);
+  for (int i = 0; i < 4; i++) {
+    if (list_aisles[i] != ref_to_aisle(secs[i])) {
+      fail("aisle_apply_ops list", "aisle differs", k);
+    }
+  }
+}
+
+/*
+ * FUZZ_LAYOUT(name) defines fuzz_layout_name, which checks one random
+ * operation on a random aisle of the aisle_layout.h layout name against the
+ * model, like fuzz_aisle_case does for aisle64. n runs from below 0 to past
+ * the number of spaces, and set_id also tries ids one bit too wide.
+ */
+#define FUZZ_LAYOUT(name)                                                     \
+  static void fuzz_layout_##name(unsigned long* state, long k) {              \
+    enum { WORDS = sizeof(name##_t) / sizeof(uint64_t) };                     \
+    struct ref_section secs[name##_NUM_SECTIONS];                             \
+    uint64_t words[WORDS];                                                    \
+    uint64_t expect[WORDS];                                                   \
+    name##_t aisle = 0;                                                       \
+    int j = (int)(next_random(state) % name##_NUM_SECTIONS);                  \
+    int n = (int)(next_random(state) % (name##_NUM_SPACES + 7)) - 3;          \
+    int op = (int)(next_random(state) % 5);                                   \
+                                                                              \
+    for (int w = 0; w < WORDS; w++) {                                         \
+      words[w] = ((uint64_t) next_random(state) << 32) | next_random(state);  \
+    }                                                                         \
+    ref_from_words(secs, name##_NUM_SECTIONS, name##_ID_SIZE,                 \
+                   name##_NUM_SPACES, words);                                 \
+    /* Empty and full sections, where the edge cases are */                   \
+    switch (next_random(state) % 4) {                                         \
+      case 0:                                                                 \
+        ref_remove_items(&secs[j], MAX_SPACES);                               \
+        break;                                                                \
+      case 1:                                                                 \
+        ref_add_items(&secs[j], MAX_SPACES);                                  \
+        break;                                                                \
+    }                                                                         \
+    ref_to_words(secs, name##_NUM_SECTIONS, WORDS, words);                    \
+    for (int w = WORDS - 1; w >= 0; w--) {                                    \
+      aisle = (name##_t)(aisle << 32 << 32) | words[w];                       \
+    }                                                                         \
+                                                                              \
+    switch (op) {                                                             \
+      case 0:                                                                 \
+        ref_add_items(&secs[j], n);                                           \
+        name##_add_items(&aisle, j, n);                                       \
+        break;                                                                \
+      case 1:                                                                 \
+        ref_remove_items(&secs[j], n);                                        \
+        name##_remove_items(&aisle, j, n);                                    \
+        break;                                                                \
+      case 2:                                                                 \
+        ref_rotate_left(&secs[j], n);                                         \
+        name##_rotate_items_left(&aisle, j, n);                               \
+        break;                                                                \
+      case 3:                                                                 \
+        ref_rotate_left(&secs[j], -n);                                        \
+        name##_rotate_items_right(&aisle, j, n);                              \
+        break;                                                                \
+      case 4:                                                                 \
+        n += (1 << name##_ID_SIZE) - 4;                                       \
+        ref_set_id(&secs[j], n);                                              \
+        name##_set_id(&aisle, j, (uint32_t) n);                               \
+        break;                                                                \
+    }                                                                         \
+                                                                              \
+    ref_to_words(secs, name##_NUM_SECTIONS, WORDS, expect);                   \
+    for (int w = 0; w < WORDS; w++) {                                         \
+      if ((uint64_t)(aisle >> (64 * w)) != expect[w]) {                       \
+        fail("aisle_layout " #name, "aisle differs", k);                      \
+        break;                                                                \
+      }                                                                       \
+    }                                                                         \
+    if (name##_num_items(&aisle, j) != ref_count(&secs[j])) {                 \
+      fail("aisle_layout " #name, "count differs", k);                        \
+    }                                                                         \
+  }
+
+FUZZ_LAYOUT(aisle64)
+FUZZ_LAYOUT(aisle32x2)
+#ifdef __SIZEOF_INT128__
+FUZZ_LAYOUT(aisle128)
+FUZZ_LAYOUT(aisle128x4)
+#endif
+
+/* Compares the aisles, stockroom and derived totals of v with the model. */
+static void compare_state(const struct variant* var, void* v,
+                          struct ref_store* r, long k) {
+  for (size_t i = 0; i < r->num_aisles; i++) {
+    if (var->get_aisle(v, i) != ref_get_aisle(r, i)) {
+      fail(var->name, "aisles differ", k);
+      break;
+    }
+  }
+  for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (var->get_stock(v, id) != r->stock[id]) {
+      fail(var->name, "stockroom differs", k);
+      break;
+    }
+  }
+}
+
+/* Runs the workload on the model and on every variant that fits num_aisles,
+ * comparing as it goes. */
+static void fuzz_stores(size_t num_aisles, long num_ops, unsigned long seed) {
+  struct op* ops = malloc((size_t) num_ops * sizeof(struct op));
+  void* v[NUM_VARIANTS] = {NULL};
+  struct ref_store* r = ref_create(num_aisles);
+  struct store_stats stats;
+  struct store_order orders[MAX_BATCH];
+  int expect_filled[MAX_BATCH];
+  int filled[MAX_BATCH];
+  unsigned long state = seed;
+
+  if (ops == NULL || r == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  make_workload(ops, (size_t) num_ops, num_aisles, &state);
+  setup(&reference, r, num_aisles, seed);
+  for (int t = 0; t < NUM_VARIANTS; t++) {
+    if (variants[t].fixed_aisles != 0 && variants[t].fixed_aisles != num_aisles) {
+      continue;
+    }
+    v[t] = variants[t].create(num_aisles);
+    if (v[t] == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    setup(&variants[t], v[t], num_aisles, seed);
+    if (t == 0) {
+      store_attach_stats(v[t], &stats);  // variants[0] is store.c
+    }
+  }
+
+  for (long k = 0; k < num_ops; k++) {
+    const struct op* op = &ops[k];
+    long expect;
+    if (op->kind == OP_BATCH) {
+      make_batch(op, orders);
+    }
+    expect = run_op(&reference, r, op, orders, expect_filled);
+    for (int t = 0; t < NUM_VARIANTS; t++) {
+      if (v[t] == NULL) {
+        continue;
+      }
+      if (run_op(&variants[t], v[t], op, orders, filled) != expect) {
+        fail(variants[t].name, op_names[op->kind], k);
+      }
+      if (op->kind == OP_BATCH &&
+          memcmp(filled, expect_filled, (size_t) op->num * sizeof(int)) != 0) {
+        fail(variants[t].name, "batch order counts", k);
+      }
+      if (k % CHECK_EVERY == 0 || k == num_ops - 1) {
+        compare_state(&variants[t], v[t], r, k);
+      }
+    }
+
+    if (k % CHECK_EVERY == 0 || k == num_ops - 1) {
+      // store.c's shelf totals and the streamed statistics
+      long items[STORE_NUM_ITEMS] = {0};
+      long total = 0;
+      for (size_t i = 0; i < num_aisles * STORE_SECTIONS_PER_AISLE; i++) {
+        items[r->sections[i].id] += ref_count(&r->sections[i]);
+        total += ref_count(&r->sections[i]);
+      }
+      for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+        long have = items[id] + r->stock[id];
+        if (store_shelf_items(v[0], id) != items[id]) {
+          fail("store", "shelf items", k);
+        }
+        if (store_can_fill(v[0], id, (int) have) != 1 ||
+            store_can_fill(v[0], id, (int) have + 1) != 0) {
+          fail("store", "can_fill", k);
+        }
+        if (stats.shelf_items[id] != items[id]) {
+          fail("store_analytics", "shelf items", k);
+        }
+      }
+      if (stats.total_items != total) {
+        fail("store_analytics", "total items", k);
+      }
+    }
+  }
+
+  for (int t = 0; t < NUM_VARIANTS; t++) {
+    if (v[t] != NULL) {
+      printf("  %-18s %zu aisles, %ld operations\n", variants[t].name,
+             num_aisles, num_ops);
+      variants[t].destroy(v[t]);
+    }
+  }
+  ref_destroy(r);
+  free(ops);
+}
+
+static void fuzz(size_t num_aisles, long num_ops, unsigned long seed) {
+  unsigned long state = seed;
+
+  printf("fuzzing against the reference model\n");
+  for (long k = 0; k < num_ops; k++) {
+    fuzz_aisle_case(&state, k);
+    if (k % 8 == 0) {
+      fuzz_op_list(&state, k);
+    }
+    fuzz_layout_aisle64(&state, k);
+    fuzz_layout_aisle32x2(&state, k);
+#ifdef __SIZEOF_INT128__
+    fuzz_layout_aisle128(&state, k);
+    fuzz_layout_aisle128x4(&state, k);
+#endif
+  }
+  printf("  %-18s %ld cases\n", "aisle operations", num_ops);
+  printf("  %-18s %ld cases per layout\n", "aisle_layout", num_ops);
+  fuzz_stores(CLIENT_AISLES, num_ops, seed);
+  if (num_aisles != CLIENT_AISLES) {
+    fuzz_stores(num_aisles, num_ops / 4 > 0 ? num_ops / 4 : 1, seed + 1);
+  }
+  printf("%s\n", failures == 0 ? "ok" : "MISMATCHES FOUND");
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Crash recovery
+ * ----------------------------------------------------------------------------
+ *
+ * Runs the workload on a store with a store_log attached, committing after
+ * random runs of operations and taking a snapshot now and then, and checks
+ * that store_log_recover rebuilds the store as of the last commit. Then it
+ * cuts the last batch of the log in half (a crash during the write), puts
+ * back a log a snapshot already holds (a crash between the snapshot's rename
+ * and emptying the log), damages the snapshot in several ways, and makes a
+ * commit fail, and checks that each is handled as store_log.h says.
+ */
+
+// The aisles and stockroom of a store at one point
+struct saved_state {
+  size_t num_aisles;
+  unsigned long* aisles;
+  int stock[STORE_NUM_ITEMS];
+};
+
+static void save_state(struct saved_state* saved, const store* s) {
+  saved->num_aisles = store_num_aisles(s);
+  memcpy(saved->aisles, store_aisles(s), saved->num_aisles * sizeof(unsigned long));
+  for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+    saved->stock[id] = store_get_stock(s, id);
+  }
+}
+
+static void copy_state(struct saved_state* to, const struct saved_state* from) {
+  to->num_aisles = from->num_aisles;
+  memcpy(to->aisles, from->aisles, from->num_aisles * sizeof(unsigned long));
+  memcpy(to->stock, from->stock, sizeof(to->stock));
+}
+
+/* Returns whether s is the saved state; a NULL s is not. */
+static int same_state(const store* s, const struct saved_state* saved) {
+  if (s == NULL || store_num_aisles(s) != saved->num_aisles ||
+      memcmp(store_aisles(s), saved->aisles,
+             saved->num_aisles * sizeof(unsigned long)) != 0) {
+    return 0;
+  }
+  for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+    if (store_get_stock(s, id) != saved->stock[id]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Checks that recovering path gives the saved state. */
+static void check_recovery(const char* path, const struct saved_state* saved,
+                           const char* what, long k) {
+  store* recovered = store_log_recover(path, saved->num_aisles);
+  if (!same_state(recovered, saved)) {
+    fail("store_log", what, k);
+  }
+  store_destroy(recovered);
+}
+
+/* Returns the size of the file at path, or -1. */
+static off_t file_size(const char* path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+/* Checks that recovery rejects path.snap with len bytes of value written at
+ * offset, then puts the good snapshot (good_len bytes of good) back. */
+static void check_damaged_snapshot(const char* path, const char* snap_path,
+                                   const char* good, size_t good_len,
+                                   off_t offset, const void* value, size_t len,
+                                   const char* what) {
+  int fd = open(snap_path, O_WRONLY);
+  store* recovered;
+
+  if (fd < 0 || pwrite(fd, value, len, offset) != (ssize_t) len) {
+    fail("store_log", "could not damage the snapshot", 0);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  recovered = store_log_recover(path, 1);
+  if (recovered != NULL) {
+    fail("store_log damaged snapshot", what, 0);
+    store_destroy(recovered);
+  }
+  fd = open(snap_path, O_WRONLY | O_TRUNC);
+  if (fd < 0 || write(fd, good, good_len) != (ssize_t) good_len) {
+    fail("store_log", "could not restore the snapshot", 0);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+static void test_log(size_t num_aisles, long num_ops, unsigned long seed) {
+  char dir[] = "/tmp/store_harness.XXXXXX";
+  char path[48], full_path[48];
+  char log_path[64], snap_path[64], full_log[64];
+  struct saved_state committed, before;   // before the log's last batch
+  struct op* ops = malloc((size_t) num_ops * sizeof(struct op));
+  struct store_order orders[MAX_BATCH];
+  int filled[MAX_BATCH];
+  unsigned long state = seed;
+  long commits = 0, snapshots = 0;
+  store* s;
+  store_log* log;
+
+  if (num_aisles > 1024) {
+    num_aisles = 1024;  // every check recovers the whole store
+  }
+  committed.aisles = malloc(num_aisles * sizeof(unsigned long));
+  before.aisles = malloc(num_aisles * sizeof(unsigned long));
+  s = store_create(num_aisles);
+  if (ops == NULL || committed.aisles == NULL || before.aisles == NULL ||
+      s == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr, "can not make a directory in /tmp\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(path, sizeof(path), "%s/store", dir);
+  snprintf(log_path, sizeof(log_path), "%s.log", path);
+  snprintf(snap_path, sizeof(snap_path), "%s.snap", path);
+  make_workload(ops, (size_t) num_ops, num_aisles, &state);
+
+  // Commit, snapshot and recover round trips
+  setup(&variants[0], s, num_aisles, seed);
+  log = store_log_open(path, s, 0);
+  if (log == NULL || store_log_snapshot(log) != 0) {
+    fprintf(stderr, "can not save the store in %s\n", dir);
+    exit(EXIT_FAILURE);
+  }
+  save_state(&committed, s);
+  for (long k = 0; k < num_ops;) {
+    off_t log_size;
+    long run = 1 + (long)(next_random(&state) % 64);
+    for (; run > 0 && k < num_ops; run--, k++) {
+      if (ops[k].kind == OP_BATCH) {
+        make_batch(&ops[k], orders);
+      }
+      run_op(&variants[0], s, &ops[k], orders, filled);
+    }
+    // Writes that were not committed are lost
+    check_recovery(path, &committed, "uncommitted writes recovered", k);
+    log_size = file_size(log_path);
+    if (store_log_commit(log) != 0) {
+      fail("store_log", "commit failed", k);
+    }
+    if (file_size(log_path) != log_size) {
+      copy_state(&before, &committed);
+    }
+    save_state(&committed, s);
+    commits++;
+    if (next_random(&state) % 8 == 0) {
+      if (store_log_snapshot(log) != 0) {
+        fail("store_log", "snapshot failed", k);
+      }
+      snapshots++;
+    }
+    check_recovery(path, &committed, "committed writes not recovered", k);
+  }
+  if (store_log_close(log) != 0) {
+    fail("store_log", "close failed", num_ops);
+  }
+
+  // A torn tail: the last batch cut off in the middle is dropped as a whole
+  if (file_size(log_path) > 0) {
+    if (truncate(log_path, file_size(log_path) - 5) != 0) {
+      fail("store_log", "could not cut the log", 0);
+    }
+    check_recovery(path, &before, "torn batch not dropped", 0);
+  }
+  // Reopening cuts it off for good, and new batches are replayed after it
+  store_destroy(s);
+  s = store_log_recover(path, num_aisles);
+  log = s != NULL ? store_log_open(path, s, STORE_LOG_SYNC) : NULL;
+  if (log == NULL) {
+    fail("store_log", "can not reopen after a torn tail", 0);
+  } else {
+    store_refill_from_stockroom(s);
+    store_fulfill_order(s, 1, 25);
+    if (store_log_commit(log) != 0 || store_log_close(log) != 0) {
+      fail("store_log", "commit after a torn tail failed", 0);
+    }
+    save_state(&committed, s);
+    check_recovery(path, &committed, "batch after a torn tail lost", 0);
+  }
+
+  // A crash after a snapshot was renamed into place but before the log was
+  // emptied: the batches the snapshot holds are skipped, and batches added
+  // to that log after reopening it are still replayed
+  if (s != NULL && (log = store_log_open(path, s, 0)) != NULL) {
+    size_t old_len;
+    char* old_log;
+    int fd;
+
+    store_fulfill_order(s, 2, 30);
+    store_refill_from_stockroom(s);
+    if (store_log_commit(log) != 0) {
+      fail("store_log", "commit failed", 0);
+    }
+    old_len = (size_t) file_size(log_path);
+    old_log = malloc(old_len);
+    fd = open(log_path, O_RDONLY);
+    if (old_log == NULL || fd < 0 || read(fd, old_log, old_len) != (ssize_t) old_len) {
+      fail("store_log", "can not read the log", 0);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    if (store_log_snapshot(log) != 0 || store_log_close(log) != 0) {
+      fail("store_log", "snapshot failed", 0);
+    }
+    save_state(&committed, s);
+    fd = open(log_path, O_WRONLY | O_TRUNC);
+    if (old_log == NULL || fd < 0 ||
+        write(fd, old_log, old_len) != (ssize_t) old_len) {
+      fail("store_log", "can not put the old log back", 0);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    free(old_log);
+    check_recovery(path, &committed, "log held by the snapshot replayed", 0);
+
+    store_destroy(s);
+    s = store_log_recover(path, num_aisles);
+    log = s != NULL ? store_log_open(path, s, 0) : NULL;
+    if (log == NULL) {
+      fail("store_log", "can not reopen a log held by the snapshot", 0);
+    } else {
+      store_set_stock(s, 3, store_get_stock(s, 3) + 40);
+      store_refill_from_stockroom(s);
+      if (store_log_close(log) != 0) {
+        fail("store_log", "commit after a log held by the snapshot failed", 0);
+      }
+      save_state(&committed, s);
+      check_recovery(path, &committed, "batch after a log held by the snapshot lost", 0);
+    }
+  }
+
+  // Damaged snapshots are rejected, never read out of bounds
+  if (s != NULL) {
+    log = store_log_open(path, s, 0);
+    if (log == NULL || store_log_snapshot(log) != 0 || store_log_close(log) != 0) {
+      fail("store_log", "snapshot failed", 0);
+    }
+  }
+  {
+    size_t snap_len = (size_t) file_size(snap_path);
+    char* good = malloc(snap_len);
+    int fd = open(snap_path, O_RDONLY);
+    uint32_t huge_offset = 64 << 20;
+    uint32_t odd_offset = 4097;
+    uint64_t huge_count = 1UL << 40;
+    uint64_t bad_magic = 0;
+
+    if (good == NULL || fd < 0 || read(fd, good, snap_len) != (ssize_t) snap_len) {
+      fail("store_log", "can not read the snapshot", 0);
+    } else {
+      // Offsets of data_offset, num_aisles and magic in the header
+      check_damaged_snapshot(path, snap_path, good, snap_len, 12, &huge_offset,
+                             sizeof(huge_offset), "aisles past the end");
+      check_damaged_snapshot(path, snap_path, good, snap_len, 12, &odd_offset,
+                             sizeof(odd_offset), "misaligned aisles");
+      check_damaged_snapshot(path, snap_path, good, snap_len, 16, &huge_count,
+                             sizeof(huge_count), "too many aisles");
+      check_damaged_snapshot(path, snap_path, good, snap_len, 0, &bad_magic,
+                             sizeof(bad_magic), "bad magic");
+      if (truncate(snap_path, 100) != 0) {
+        fail("store_log", "could not cut the snapshot", 0);
+      }
+      store* recovered = store_log_recover(path, num_aisles);
+      if (recovered != NULL) {
+        fail("store_log damaged snapshot", "cut short", 0);
+        store_destroy(recovered);
+      }
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    free(good);
+  }
+
+  // A failed commit is reported by every later commit and by close
+  snprintf(full_path, sizeof(full_path), "%s/full", dir);
+  snprintf(full_log, sizeof(full_log), "%s.log", full_path);
+  if (s != NULL && symlink("/dev/full", full_log) == 0 &&
+      (log = store_log_open(full_path, s, 0)) != NULL) {
+    store_set_stock(s, 0, 1);
+    if (store_log_commit(log) == 0) {
+      fail("store_log", "write to a full disk succeeded", 0);
+    }
+    store_set_stock(s, 0, 2);
+    if (store_log_commit(log) == 0 || store_log_snapshot(log) == 0) {
+      fail("store_log", "failed log accepted more commits", 0);
+    }
+    if (store_log_close(log) == 0) {
+      fail("store_log", "close of a failed log succeeded", 0);
+    }
+  }
+
+  unlink(full_log);
+  unlink(log_path);
+  unlink(snap_path);
+  rmdir(dir);
+  store_destroy(s);
+  free(committed.aisles);
+  free(before.aisles);
+  free(ops);
+  printf("  %-18s %zu aisles, %ld commits, %ld snapshots\n", "store_log",
+         num_aisles, commits, snapshots);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Shared store files
+ * ----------------------------------------------------------------------------
+ *
+ * Runs the workload on a store file that a read-only store in the same
+ * process follows, and at every checkpoint forks a child that opens the file
+ * read-only as well. Both readers' queries must agree with the writer's
+ * indexed answers, and the child must not be able to open the file for
+ * writing. At the end the writer is closed, after which the file can be
+ * opened for writing again and the rebuilt indexes must agree too.
+ */
+
+// Checkpoints of the shared file check
+#define SHARED_CHECKS 8
+
+/* Returns how many of the reader's answers differ from the writer's. */
+static int compare_reader(store* reader, store* writer) {
+  size_t num_aisles = store_num_aisles(writer);
+  int mismatches = 0;
+
+  if (store_num_aisles(reader) != num_aisles ||
+      memcmp(store_aisles(reader), store_aisles(writer),
+             num_aisles * sizeof(unsigned long)) != 0) {
+    return 1;
+  }
+  for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+    long have = store_shelf_items(writer, id) + store_get_stock(writer, id);
+    mismatches += store_get_stock(reader, id) != store_get_stock(writer, id);
+    mismatches += store_shelf_items(reader, id) != store_shelf_items(writer, id);
+    mismatches += store_can_fill(reader, id, (int) have) != 1 ||
+                  store_can_fill(reader, id, (int) have + 1) != 0;
+    mismatches += position(store_aisles(reader), store_empty_section_with_id(reader, id)) !=
+                  position(store_aisles(writer), store_empty_section_with_id(writer, id));
+  }
+  mismatches += position(store_aisles(reader), store_section_with_most_items(reader)) !=
+                position(store_aisles(writer), store_section_with_most_items(writer));
+  return mismatches;
+}
+
+/* Checks the writer from a child process: a new read-only store must agree
+ * with it, and a second writer must be refused. */
+static void check_other_process(const char* path, store* writer, long k) {
+  pid_t pid = fork();
+  int status;
+
+  if (pid < 0) {
+    fail("store file", "can not fork", k);
+    return;
+  }
+  if (pid == 0) {
+    store* reader = store_open_readonly(path);
+    store* second = store_open(path);
+    int result = 0;
+    if (reader == NULL || compare_reader(reader, writer) != 0) {
+      result |= 1;
+    }
+    if (second != NULL) {
+      result |= 2;
+    }
+    _exit(result);
+  }
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+    fail("store file", "child process failed", k);
+  } else {
+    if (WEXITSTATUS(status) & 1) {
+      fail("store file", "reader in another process differs", k);
+    }
+    if (WEXITSTATUS(status) & 2) {
+      fail("store file", "second writer allowed in another process", k);
+    }
+  }
+}
+
+static void test_shared_file(size_t num_aisles, long num_ops,
+                             unsigned long seed) {
+  char dir[] = "/tmp/store_harness.XXXXXX";
+  char path[48];
+  struct op* ops = malloc((size_t) num_ops * sizeof(struct op));
+  struct store_order orders[MAX_BATCH];
+  int filled[MAX_BATCH];
+  unsigned long state = seed;
+  store *writer, *reader, *reopened;
+
+  if (num_aisles > 1024) {
+    num_aisles = 1024;  // every check scans the whole store many times
+  }
+  if (ops == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr, "can not make a directory in /tmp\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(path, sizeof(path), "%s/store", dir);
+  make_workload(ops, (size_t) num_ops, num_aisles, &state);
+
+  writer = store_create_file(path, num_aisles);
+  reader = store_open_readonly(path);
+  if (writer == NULL || reader == NULL) {
+    fprintf(stderr, "can not make a store file in %s\n", dir);
+    exit(EXIT_FAILURE);
+  }
+  if (store_open(path) != NULL) {
+    fail("store file", "second writer allowed", 0);
+  }
+  setup(&variants[0], writer, num_aisles, seed);
+  for (long k = 0; k < num_ops; k++) {
+    if (ops[k].kind == OP_BATCH) {
+      make_batch(&ops[k], orders);
+    }
+    run_op(&variants[0], writer, &ops[k], orders, filled);
+    if ((k + 1) % (num_ops / SHARED_CHECKS + 1) == 0 || k == num_ops - 1) {
+      if (compare_reader(reader, writer) != 0) {
+        fail("store file", "reader differs", k);
+      }
+      check_other_process(path, writer, k);
+    }
+  }
+
+  // Readers can not change the store
+  store_fulfill_order(reader, ops[0].id, 5);
+  store_set_stock(reader, 0, 12345);
+  store_refill_from_stockroom(reader);
+  if (compare_reader(reader, writer) != 0) {
+    fail("store file", "reader changed the store", num_ops);
+  }
+
+  // Once the writer is gone another one may open the file
+  store_destroy(writer);
+  reopened = store_open(path);
+  if (reopened == NULL) {
+    fail("store file", "can not reopen for writing", num_ops);
+  } else {
+    if (compare_reader(reader, reopened) != 0) {
+      fail("store file", "rebuilt indexes differ", num_ops);
+    }
+    store_destroy(reopened);
+  }
+
+  store_destroy(reader);
+  unlink(path);
+  rmdir(dir);
+  free(ops);
+  printf("  %-18s %zu aisles, %ld operations, %d checks\n", "store file",
+         num_aisles, num_ops, SHARED_CHECKS);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Registry
+ * ----------------------------------------------------------------------------
+ *
+ * Runs the workload on an indexed and a compact registry store next to the
+ * model, as fuzz_stores does for the other stores. Then runs random refill
+ * and fulfill jobs over many stores of both kinds with registry_run on
+ * several threads, and the same jobs one at a time on an identical registry,
+ * and checks that every job's result and every store come out the same.
+ */
+
+// Stores and threads of the registry_run check, and jobs per run
+#define REGISTRY_STORES 16
+#define REGISTRY_THREADS 4
+#define REGISTRY_JOBS 4096
+
+/* Runs the workload on the model and on both kinds of registry store. */
+static void fuzz_registry_stores(size_t num_aisles, long num_ops,
+                                 unsigned long seed) {
+  struct op* ops = malloc((size_t) num_ops * sizeof(struct op));
+  void* v[NUM_REGISTRY_VARIANTS];
+  struct ref_store* r = ref_create(num_aisles);
+  struct store_order orders[MAX_BATCH];
+  int expect_filled[MAX_BATCH];
+  int filled[MAX_BATCH];
+  unsigned long state = seed;
+
+  if (ops == NULL || r == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  make_workload(ops, (size_t) num_ops, num_aisles, &state);
+  setup(&reference, r, num_aisles, seed);
+  for (int t = 0; t < NUM_REGISTRY_VARIANTS; t++) {
+    v[t] = registry_variants[t].create(num_aisles);
+    if (v[t] == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    setup(&registry_variants[t], v[t], num_aisles, seed);
+  }
+
+  for (long k = 0; k < num_ops; k++) {
+    const struct op* op = &ops[k];
+    long expect;
+    if (op->kind == OP_BATCH) {
+      make_batch(op, orders);
+    }
+    expect = run_op(&reference, r, op, orders, expect_filled);
+    for (int t = 0; t < NUM_REGISTRY_VARIANTS; t++) {
+      if (run_op(&registry_variants[t], v[t], op, orders, filled) != expect) {
+        fail(registry_variants[t].name, op_names[op->kind], k);
+      }
+      if (op->kind == OP_BATCH &&
+          memcmp(filled, expect_filled, (size_t) op->num * sizeof(int)) != 0) {
+        fail(registry_variants[t].name, "batch order counts", k);
+      }
+      if (k % CHECK_EVERY == 0 || k == num_ops - 1) {
+        compare_state(&registry_variants[t], v[t], r, k);
+      }
+    }
+  }
+
+  for (int t = 0; t < NUM_REGISTRY_VARIANTS; t++) {
+    printf("  %-18s %zu aisles, %ld operations\n", registry_variants[t].name,
+           num_aisles, num_ops);
+    registry_variants[t].destroy(v[t]);
+  }
+  ref_destroy(r);
+  free(ops);
+}
+
+/* Adds the same REGISTRY_STORES stores to r, alternating indexed and
+ * compact ones, each with up to max_aisles aisles, and fills them. */
+static void setup_registry(store_registry* r, size_t max_aisles,
+                           unsigned long seed) {
+  unsigned long state = seed;
+  for (int k = 0; k < REGISTRY_STORES; k++) {
+    size_t num_aisles = 1 + next_random(&state) % max_aisles;
+    struct reg_handle h;
+    h.r = r;
+    h.id = registry_add_store(r, num_aisles, k % 2 ? REGISTRY_COMPACT : 0);
+    if (h.id != k) {
+      fprintf(stderr, "out of memory\n");
+      exit(EXIT_FAILURE);
+    }
+    setup(&registry_variants[k % 2], &h, num_aisles, seed + (unsigned long) k);
+  }
+}
+
+/* Fills jobs with random refills and orders, a few for unknown stores. */
+static void make_jobs(struct registry_job* jobs, size_t count,
+                      unsigned long* state) {
+  for (size_t k = 0; k < count; k++) {
+    struct registry_job* job = &jobs[k];
+    int r = (int)(next_random(state) % 100);
+    job->store_id = r == 0 ? -1
+                  : r == 1 ? REGISTRY_STORES
+                  : (int)(next_random(state) % REGISTRY_STORES);
+    job->kind = next_random(state) % 10 == 0 ? REGISTRY_REFILL : REGISTRY_FULFILL;
+    job->id = random_id(state);
+    job->num = next_random(state) % 10 == 0 ? 20 + (int)(next_random(state) % 60)
+                                            : (int)(next_random(state) % 6);
+    job->result = INT_MIN;
+  }
+}
+
+/* Compares every store of two registries set up by setup_registry. */
+static void compare_registries(store_registry* a, store_registry* b, long k) {
+  for (int s = 0; s < REGISTRY_STORES; s++) {
+    size_t num_aisles = registry_num_aisles(a, s);
+    if (registry_num_aisles(b, s) != num_aisles) {
+      fail("registry_run", "store sizes differ", k);
+      return;
+    }
+    for (size_t i = 0; i < num_aisles; i++) {
+      unsigned long x = 0, y = 0;
+      registry_get_aisle(a, s, i, &x);
+      registry_get_aisle(b, s, i, &y);
+      if (x != y) {
+        fail("registry_run", "aisles differ", k);
+        return;
+      }
+    }
+    for (unsigned short id = 0; id < STORE_NUM_ITEMS; id++) {
+      if (registry_get_stock(a, s, id) != registry_get_stock(b, s, id)) {
+        fail("registry_run", "stockroom differs", k);
+        return;
+      }
+    }
+  }
+}
+
+/* Runs num_jobs jobs in rounds of REGISTRY_JOBS with registry_run on one
+ * registry and one at a time on another, restocking both between rounds. */
+static void fuzz_registry_run(size_t max_aisles, long num_jobs,
+                              unsigned long seed) {
+  store_registry* parallel = registry_create(REGISTRY_STORES);
+  store_registry* sequential = registry_create(REGISTRY_STORES);
+  struct registry_job* jobs = malloc(REGISTRY_JOBS * sizeof(struct registry_job));
+  unsigned long state = seed;
+  long rounds = 0;
+
+  if (parallel == NULL || sequential == NULL || jobs == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  setup_registry(parallel, max_aisles, seed);
+  setup_registry(sequential, max_aisles, seed);
+
+  for (long done = 0; done < num_jobs; done += REGISTRY_JOBS, rounds++) {
+    size_t count = num_jobs - done < REGISTRY_JOBS ? (size_t)(num_jobs - done)
+                                                   : REGISTRY_JOBS;
+    make_jobs(jobs, count, &state);
+    // Every fourth round passes a negative thread count, which means one
+    registry_run(parallel, jobs, count, rounds % 4 == 3 ? -1 : REGISTRY_THREADS);
+    for (size_t k = 0; k < count; k++) {
+      const struct registry_job* job = &jobs[k];
+      int expect = job->kind == REGISTRY_REFILL
+          ? registry_refill_from_stockroom(sequential, job->store_id)
+          : registry_fulfill_order(sequential, job->store_id, job->id, job->num);
+      if (job->result != expect) {
+        fail("registry_run", "job result", done + (long) k);
+      }
+    }
+    compare_registries(parallel, sequential, done);
+
+    for (int s = 0; s < REGISTRY_STORES; s++) {
+      unsigned short id = random_id(&state);
+      int more = 1 + (int)(next_random(&state) % 200);
+      registry_set_stock(parallel, s, id, registry_get_stock(parallel, s, id) + more);
+      registry_set_stock(sequential, s, id,
+                         registry_get_stock(sequential, s, id) + more);
+    }
+  }
+
+  printf("  %-18s %d stores, %ld jobs on %d threads\n", "registry_run",
+         REGISTRY_STORES, num_jobs, REGISTRY_THREADS);
+  registry_destroy(parallel);
+  registry_destroy(sequential);
+  free(jobs);
+}
+
+static void fuzz_registry(size_t num_aisles, long num_ops, unsigned long seed) {
+  printf("checking the store registry\n");
+  fuzz_registry_stores(num_aisles, num_ops, seed);
+  fuzz_registry_run(num_aisles, num_ops, seed + 1);
+  printf("%s\n", failures == 0 ? "ok" : "MISMATCHES FOUND");
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Benchmark
+ * ----------------------------------------------------------------------------
+ */
+
+static int compare_longs(const void* a, const void* b) {
+  long x = *(const long*) a;
+  long y = *(const long*) b;
+  return (x > y) - (x < y);
+}
+
+/* Returns the p-th percentile of the sorted values[0..count). */
+static long percentile(const long* values, size_t count, double p) {
+  size_t k = (size_t)(p / 100 * (double) count);
+  return values[k < count ? k : count - 1];
+}
+
+static void bench_variant(const struct variant* var, size_t num_aisles,
+                          const struct op* ops, long num_ops,
+                          unsigned long seed) {
+  long* latency[NUM_OP_KINDS];
+  size_t counts[NUM_OP_KINDS] = {0};
+  double busy = 0;
+  struct store_order orders[MAX_BATCH];
+  int filled[MAX_BATCH];
+  void* v = var->create(num_aisles);
+
+  for (int kind = 0; kind < NUM_OP_KINDS; kind++) {
+    latency[kind] = malloc((size_t) num_ops * sizeof(long));
+    if (latency[kind] == NULL) {
+      v = NULL;
+    }
+  }
+  if (v == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  setup(var, v, num_aisles, seed);
+
+  for (long k = 0; k < num_ops; k++) {
+    struct timespec start, end;
+    long ns;
+    if (ops[k].kind == OP_BATCH) {
+      make_batch(&ops[k], orders);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    run_op(var, v, &ops[k], orders, filled);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns = (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+    latency[ops[k].kind][counts[ops[k].kind]++] = ns;
+    busy += ns * 1e-9;
+  }
+
+  printf("%s, %zu aisles: %.0f ops/s overall\n", var->name, num_aisles,
+         num_ops / busy);
+  printf("  %-12s %9s %12s %9s %9s %9s %11s\n", "operation", "count", "ops/s",
+         "p50 ns", "p90 ns", "p99 ns", "max ns");
+  for (int kind = 0; kind < NUM_OP_KINDS; kind++) {
+    double total = 0;
+    if (counts[kind] == 0) {
+      continue;
+    }
+    for (size_t i = 0; i < counts[kind]; i++) {
+      total += latency[kind][i] * 1e-9;
+    }
+    qsort(latency[kind], counts[kind], sizeof(long), compare_longs);
+    printf("  %-12s %9zu %12.0f %9ld %9ld %9ld %11ld\n", op_names[kind],
+           counts[kind], counts[kind] / total,
+           percentile(latency[kind], counts[kind], 50),
+           percentile(latency[kind], counts[kind], 90),
+           percentile(latency[kind], counts[kind], 99),
+           latency[kind][counts[kind] - 1]);
+  }
+  for (int kind = 0; kind < NUM_OP_KINDS; kind++) {
+    free(latency[kind]);
+  }
+  var->destroy(v);
+}
+
+static void bench(size_t num_aisles, long num_ops, unsigned long seed) {
+  struct op* ops = malloc((size_t) num_ops * sizeof(struct op));
+  unsigned long state = seed;
+  double start = now();
+
+  if (ops == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  make_workload(ops, (size_t) num_ops, num_aisles, &state);
+  for (int t = 0; t < NUM_VARIANTS; t++) {
+    if (variants[t].fixed_aisles == 0 || variants[t].fixed_aisles == num_aisles) {
+      bench_variant(&variants[t], num_aisles, ops, num_ops, seed);
+    }
+  }
+  printf("(%.1f s)\n", now() - start);
+  free(ops);
+}
+
+
+int main(int argc, char* argv[]) {
+  size_t num_aisles = 4096;
+  long num_ops = 200000;
+  unsigned long seed = 351;
+  const char* mode = "all";
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:n:r:m:h")) != -1) {
+    switch (opt) {
+      case 'a':
+        num_aisles = (size_t) atol(optarg);
+        break;
+      case 'n':
+        num_ops = atol(optarg);
+        break;
+      case 'r':
+        seed = (unsigned long) atol(optarg);
+        break;
+      case 'm':
+        mode = optarg;
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-a aisles] [-n ops] [-r seed]"
+                " [-m fuzz|log|registry|bench|all]\n", argv[0]);
+        fprintf(stderr, "\t-a\taisles in the benchmarked and fuzzed stores\n");
+        fprintf(stderr, "\t-r\trandom seed (same seed, same workload)\n");
+        return EXIT_FAILURE;
+    }
+  }
+  if (num_aisles < 1 || num_ops < 1) {
+    fprintf(stderr, "need at least one aisle and one operation\n");
+    return EXIT_FAILURE;
+  }
+  if (seed == 0) {
+    seed = 1;  // xorshift never leaves 0
+  }
+
+  if (strcmp(mode, "fuzz") == 0 || strcmp(mode, "all") == 0) {
+    fuzz(num_aisles, num_ops, seed);
+  }
+  if (strcmp(mode, "log") == 0 || strcmp(mode, "all") == 0) {
+    printf("checking crash recovery\n");
+    test_log(num_aisles, num_ops / 4 > 0 ? num_ops / 4 : 1, seed);
+    test_shared_file(num_aisles, num_ops / 4 > 0 ? num_ops / 4 : 1, seed);
+    printf("%s\n", failures == 0 ? "ok" : "MISMATCHES FOUND");
+  }
+  if (strcmp(mode, "registry") == 0 || strcmp(mode, "all") == 0) {
+    fuzz_registry(num_aisles, num_ops / 4 > 0 ? num_ops / 4 : 1, seed);
+  }
+  if (strcmp(mode, "bench") == 0 || strcmp(mode, "all") == 0) {
+    bench(num_aisles, num_ops, seed);
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,548 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Keeps a store's state on disk so a crash does not lose it, as two files:
+ *
+ *   path.log   an append-only log of every aisle and stockroom write
+ *   path.snap  a snapshot of the whole store
+ *
+ * Log records are 16 bytes: a key (the record type in the top byte and the
+ * aisle index or item id below it) and the new value. Since a record holds
+ * the new value and not a difference, replaying a record twice does no harm.
+ * store.c hands every write of the store to store_log_aisle/stock, which
+ * only buffer the record. store_log_commit writes everything buffered as one
+ * batch with a single write() and, with STORE_LOG_SYNC, a single fdatasync()
+ * (group commit): an order or a refill that changes many aisles costs one
+ * disk flush. A batch starts with a header holding its record count and a
+ * checksum of its records, so a batch that a crash cut off is recognized and
+ * dropped as a whole.
+ *
+ * The writes a batch holds are already applied to the store, so a batch that
+ * fails to reach the log can not just be dropped: later batches would then
+ * be replayed without it and recovery would rebuild a different store. A
+ * failed commit therefore marks the log as failed, and every later commit,
+ * snapshot and close reports the failure.
+ *
+ * A snapshot is a header (with the stockroom), padded to a page, followed by
+ * the raw aisle words, which need no encoding. It is written to a temporary
+ * file that is then renamed over the old snapshot, so there is always one
+ * complete snapshot. The log is committed and flushed first and only emptied
+ * after the rename, so the two steps can not be made atomic. Instead every
+ * log starts with a header holding its generation, and the snapshot records
+ * the generation and length of the log it has folded in. Emptying the log
+ * starts the next generation. Recovery replays only the batches the snapshot
+ * does not hold: past the recorded length in a log of the same generation
+ * (the process died, or the truncate failed, after the rename), all of a
+ * newer log, and none of an older one. If emptying the log fails, the log is
+ * marked as failed like after a failed commit.
+ *
+ * Recovery maps the snapshot, copies the aisles into a new store and
+ * replays the valid batches of the log.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "store_log.h"
+
+// Records buffered before a commit is forced
+#define BUFFER_RECORDS 4096
+
+// Record types, in the top byte of a record's key
+#define RECORD_AISLE 1UL
+#define RECORD_STOCK 2UL
+#define RECORD_TYPE_SHIFT 56
+
+#define LOG_MAGIC 0x474F4C53U             // "SLOG"
+#define BATCH_MAGIC 0x4C475453U           // "STGL"
+#define SNAPSHOT_MAGIC 0x50414E5352545353UL  // "SSTRSNAP"
+#define SNAPSHOT_VERSION 2
+
+// Offset of the aisle words in a snapshot, so they are page aligned
+#define SNAPSHOT_DATA_OFFSET 4096
+
+struct log_record {
+  uint64_t key;
+  uint64_t value;
+};
+
+// At the start of every non-empty log. The same size as a record, so it
+// fits in a slot in front of the log's first batch.
+struct log_header {
+  uint32_t magic;
+  uint32_t unused;
+  uint64_t generation;
+};
+
+// The same size as a record, so it fits in the slot in front of a batch
+struct batch_header {
+  uint32_t magic;
+  uint32_t count;                 // records in the batch
+  uint64_t checksum;              // of the records
+};
+
+struct snapshot_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t data_offset;           // where the aisle words start
+  uint64_t num_aisles;
+  uint64_t log_generation;        // the log this snapshot holds
+  uint64_t log_end;               // up to here
+  int32_t stockroom[STORE_NUM_ITEMS];
+};
+
+// The part of the logs a snapshot (or no snapshot, all zero) holds
+struct log_mark {
+  uint64_t generation;
+  uint64_t end;
+};
+
+struct store_log {
+  store* s;
+  int fd;
+  int flags;
+  char log_path[PATH_MAX];
+  char snap_path[PATH_MAX];
+  uint64_t generation;            // of the log, written with its header
+  off_t end;                      // length of the log's complete batches
+  size_t count;                   // records buffered
+  int failed;                     // a commit failed, the log is incomplete
+  // buffer[0] is room for the log header, buffer[1] for the batch header,
+  // and the records follow them
+  struct log_record buffer[BUFFER_RECORDS + 2];
+};
+
+
+/* Returns the 64-bit FNV-1a hash of len bytes at data. */
+static uint64_t checksum(const void* data, size_t len) {
+  const unsigned char* p = data;
+  uint64_t h = 0xCBF29CE484222325UL;
+  for (size_t i = 0; i < len; i++) {
+    h = (h ^ p[i]) * 0x100000001B3UL;
+  }
+  return h;
+}
+
+/* Writes all len bytes of data to fd. Returns 0 on success and -1 on error. */
+static int write_all(int fd, const void* data, size_t len) {
+  const char* p = data;
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      return -1;
+    }
+    p += n;
+    len -= (size_t) n;
+  }
+  return 0;
+}
+
+/* Fills in path.log and path.snap. Returns -1 if path is too long. */
+static int make_paths(const char* path, char* log_path, char* snap_path) {
+  if (snprintf(log_path, PATH_MAX, "%s.log", path) >= PATH_MAX ||
+      snprintf(snap_path, PATH_MAX, "%s.snap", path) >= PATH_MAX) {
+    return -1;
+  }
+  return 0;
+}
+
+
+/* Applies one log record to s. */
+static void replay_record(store* s, const struct log_record* r) {
+  uint64_t type = r->key >> RECORD_TYPE_SHIFT;
+  uint64_t target = r->key & ((1UL << RECORD_TYPE_SHIFT) - 1);
+
+  if (type == RECORD_AISLE) {
+    store_set_aisle(s, (size_t) target, (unsigned long) r->value);
+  } else if (type == RECORD_STOCK) {
+    store_set_stock(s, (unsigned short) target, (int)(int64_t) r->value);
+  }
+}
+
+/* Reads the header of the len-byte log at data into *h. Returns 0 if the
+ * log has a valid header and -1 if it is empty or damaged. */
+static int read_log_header(const char* data, size_t len, struct log_header* h) {
+  if (data == NULL || len < sizeof(*h)) {
+    return -1;
+  }
+  memcpy(h, data, sizeof(*h));
+  return h->magic == LOG_MAGIC ? 0 : -1;
+}
+
+/*
+ * scan_log - Walks the complete batches of the len-byte log at data, which
+ *     has a valid header, applying the records of the batches that end past
+ *     offset skip to s unless s is NULL. Returns the length of the valid part
+ *     of the log, i.e. where the first damaged or cut-off batch starts.
+ */
+static size_t scan_log(const char* data, size_t len, store* s, size_t skip) {
+  size_t pos = sizeof(struct log_header);
+
+  while (len - pos >= sizeof(struct batch_header)) {
+    struct batch_header h;
+    const struct log_record* records;
+    size_t bytes;
+    memcpy(&h, data + pos, sizeof(h));
+    bytes = (size_t) h.count * sizeof(struct log_record);
+    if (h.magic != BATCH_MAGIC ||
+        len - pos - sizeof(h) < bytes) {
+      break;
+    }
+    records = (const struct log_record*)(data + pos + sizeof(h));
+    if (checksum(records, bytes) != h.checksum) {
+      break;
+    }
+    if (s != NULL && pos + sizeof(h) + bytes > skip) {
+      for (uint32_t k = 0; k < h.count; k++) {
+        replay_record(s, &records[k]);
+      }
+    }
+    pos += sizeof(h) + bytes;
+  }
+  return pos;
+}
+
+/* Maps the file open as fd read-only. Returns its contents, or NULL if it is
+ * empty or can not be mapped, and sets *len to its size. */
+static char* map_file(int fd, size_t* len) {
+  struct stat st;
+  char* data;
+
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    *len = 0;
+    return NULL;
+  }
+  *len = (size_t) st.st_size;
+  data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+
+/*
+ * load_snapshot - Creates a store from the snapshot open as fd and stores
+ *     the part of the logs it holds in *mark. Returns NULL if the snapshot
+ *     is damaged or memory runs out.
+ */
+static store* load_snapshot(int fd, struct log_mark* mark) {
+  struct snapshot_header h;
+  const unsigned long* aisles;
+  store* s;
+  size_t len;
+  char* data = map_file(fd, &len);
+
+  if (data == NULL || len < sizeof(h)) {
+    goto damaged;
+  }
+  memcpy(&h, data, sizeof(h));
+  if (h.magic != SNAPSHOT_MAGIC || h.version != SNAPSHOT_VERSION ||
+      h.data_offset < sizeof(h) || h.data_offset > len ||
+      h.data_offset % sizeof(unsigned long) != 0 ||
+      h.num_aisles == 0 ||
+      (len - h.data_offset) / sizeof(unsigned long) < h.num_aisles) {
+    goto damaged;
+  }
+  mark->generation = h.log_generation;
+  mark->end = h.log_end;
+  s = store_create((size_t) h.num_aisles);
+  if (s == NULL) {
+    munmap(data, len);
+    return NULL;
+  }
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    store_set_stock(s, (unsigned short) id, h.stockroom[id]);
+  }
+  // New aisles are empty, so only the others need to be written (and indexed)
+  aisles = (const unsigned long*)(data + h.data_offset);
+  for (size_t i = 0; i < h.num_aisles; i++) {
+    if (aisles[i] != 0) {
+      store_set_aisle(s, i, aisles[i]);
+    }
+  }
+  munmap(data, len);
+  return s;
+
+damaged:
+  if (data != NULL) {
+    munmap(data, len);
+  }
+  return NULL;
+}
+
+/* Reads the part of the logs the snapshot at snap_path holds into *mark,
+ * all zero if there is no valid snapshot. */
+static void read_log_mark(const char* snap_path, struct log_mark* mark) {
+  struct snapshot_header h;
+  int fd = open(snap_path, O_RDONLY);
+
+  mark->generation = 0;
+  mark->end = 0;
+  if (fd < 0) {
+    return;
+  }
+  if (read(fd, &h, sizeof(h)) == (ssize_t) sizeof(h) &&
+      h.magic == SNAPSHOT_MAGIC && h.version == SNAPSHOT_VERSION) {
+    mark->generation = h.log_generation;
+    mark->end = h.log_end;
+  }
+  close(fd);
+}
+
+store* store_log_recover(const char* path, size_t num_aisles) {
+  char log_path[PATH_MAX], snap_path[PATH_MAX];
+  struct log_mark mark = {0, 0};
+  store* s;
+  int fd;
+
+  if (make_paths(path, log_path, snap_path) != 0) {
+    return NULL;
+  }
+
+  fd = open(snap_path, O_RDONLY);
+  if (fd >= 0) {
+    s = load_snapshot(fd, &mark);
+    close(fd);
+  } else {
+    s = store_create(num_aisles);
+  }
+  if (s == NULL) {
+    return NULL;
+  }
+
+  fd = open(log_path, O_RDONLY);
+  if (fd >= 0) {
+    size_t len;
+    char* data = map_file(fd, &len);
+    struct log_header h;
+    if (read_log_header(data, len, &h) == 0) {
+      // Skip what the snapshot already holds, see the top of this file
+      size_t skip = h.generation > mark.generation ? 0
+                  : h.generation == mark.generation ? (size_t) mark.end
+                  : SIZE_MAX;
+      scan_log(data, len, s, skip);
+    }
+    if (data != NULL) {
+      munmap(data, len);
+    }
+    close(fd);
+  }
+  return s;
+}
+
+
+store_log* store_log_open(const char* path, store* s, int flags) {
+  store_log* log = malloc(sizeof(*log));
+  struct log_header h;
+  struct log_mark mark;
+  size_t len, valid;
+  char* data;
+
+  if (log == NULL) {
+    return NULL;
+  }
+  if (make_paths(path, log->log_path, log->snap_path) != 0) {
+    free(log);
+    return NULL;
+  }
+  log->fd = open(log->log_path, O_RDWR | O_CREAT, 0644);
+  if (log->fd < 0) {
+    free(log);
+    return NULL;
+  }
+
+  // Cut off a batch that a crash left half-written, or new batches would
+  // be appended after it and never be replayed. A log without a valid
+  // header, or older than the snapshot, holds nothing recovery would use; it
+  // is emptied and becomes the generation after the snapshot's, and its
+  // header is written with its first batch.
+  data = map_file(log->fd, &len);
+  read_log_mark(log->snap_path, &mark);
+  if (read_log_header(data, len, &h) == 0 && h.generation >= mark.generation) {
+    log->generation = h.generation;
+    valid = scan_log(data, len, NULL, 0);
+  } else {
+    log->generation = mark.generation + 1;
+    valid = 0;
+  }
+  if (data != NULL) {
+    munmap(data, len);
+  }
+  if ((valid < len && ftruncate(log->fd, (off_t) valid) != 0) ||
+      lseek(log->fd, (off_t) valid, SEEK_SET) < 0) {
+    close(log->fd);
+    free(log);
+    return NULL;
+  }
+
+  log->s = s;
+  log->end = (off_t) valid;
+  log->flags = flags;
+  log->count = 0;
+  log->failed = 0;
+  store_attach_log(s, log);
+  return log;
+}
+
+int store_log_commit(store_log* log) {
+  struct batch_header h;
+  size_t bytes = log->count * sizeof(struct log_record);
+  // The first batch of a log is written together with the log's header
+  size_t first = log->end == 0 ? 0 : 1;
+  size_t header_bytes = (2 - first) * sizeof(struct log_record);
+
+  if (log->failed) {
+    return -1;
+  }
+  if (log->count == 0) {
+    return 0;
+  }
+  h.magic = BATCH_MAGIC;
+  h.count = (uint32_t) log->count;
+  h.checksum = checksum(&log->buffer[2], bytes);
+
+  // The headers go right in front of the records, so a batch is one write
+  memcpy(&log->buffer[1], &h, sizeof(h));
+  if (first == 0) {
+    struct log_header lh = {LOG_MAGIC, 0, log->generation};
+    memcpy(&log->buffer[0], &lh, sizeof(lh));
+  }
+  if (write_all(log->fd, &log->buffer[first], header_bytes + bytes) != 0 ||
+      ((log->flags & STORE_LOG_SYNC) && fdatasync(log->fd) != 0)) {
+    // Drop whatever part of the batch made it out, so later batches are not
+    // appended behind a damaged one
+    if (ftruncate(log->fd, log->end) == 0) {
+      lseek(log->fd, log->end, SEEK_SET);
+    }
+    log->failed = 1;
+    return -1;
+  }
+  log->count = 0;
+  log->end += (off_t)(header_bytes + bytes);
+  return 0;
+}
+
+static void append_record(store_log* log, uint64_t key, uint64_t value) {
+  if (log->count == BUFFER_RECORDS && store_log_commit(log) != 0) {
+    return;  // the log has failed, which every later commit reports
+  }
+  log->buffer[log->count + 2].key = key;
+  log->buffer[log->count + 2].value = value;
+  log->count++;
+}
+
+void store_log_aisle(store_log* log, size_t i, unsigned long aisle) {
+  append_record(log, (RECORD_AISLE << RECORD_TYPE_SHIFT) | i, aisle);
+}
+
+void store_log_stock(store_log* log, unsigned short id, int count) {
+  append_record(log, (RECORD_STOCK << RECORD_TYPE_SHIFT) | id,
+                (uint64_t)(int64_t) count);
+}
+
+
+/* Flushes the directory holding path, so a rename inside it is durable. */
+static void sync_parent(const char* path) {
+  char dir[PATH_MAX];
+  char* slash;
+  int fd;
+
+  strcpy(dir, path);
+  slash = strrchr(dir, '/');
+  if (slash == NULL) {
+    strcpy(dir, ".");
+  } else if (slash == dir) {
+    dir[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
+  fd = open(dir, O_RDONLY);
+  if (fd >= 0) {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+int store_log_snapshot(store_log* log) {
+  char tmp_path[PATH_MAX + 4];
+  static const char zeros[SNAPSHOT_DATA_OFFSET];
+  struct snapshot_header h;
+  store* s = log->s;
+  int fd;
+
+  // Everything up to now must be in the log before the snapshot replaces
+  // the old one, see the top of this file
+  if (store_log_commit(log) != 0) {
+    return -1;
+  }
+  if ((log->flags & STORE_LOG_SYNC) == 0 && fdatasync(log->fd) != 0) {
+    log->failed = 1;
+    return -1;
+  }
+
+  memset(&h, 0, sizeof(h));
+  h.magic = SNAPSHOT_MAGIC;
+  h.version = SNAPSHOT_VERSION;
+  h.data_offset = SNAPSHOT_DATA_OFFSET;
+  h.num_aisles = store_num_aisles(s);
+  h.log_generation = log->generation;
+  h.log_end = (uint64_t) log->end;
+  for (int id = 0; id < STORE_NUM_ITEMS; id++) {
+    h.stockroom[id] = store_get_stock(s, (unsigned short) id);
+  }
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", log->snap_path);
+  fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  if (write_all(fd, &h, sizeof(h)) != 0 ||
+      write_all(fd, zeros, SNAPSHOT_DATA_OFFSET - sizeof(h)) != 0 ||
+      write_all(fd, store_aisles(s), store_num_aisles(s) * sizeof(unsigned long)) != 0 ||
+      fsync(fd) != 0) {
+    close(fd);
+    unlink(tmp_path);
+    return -1;
+  }
+  close(fd);
+  if (rename(tmp_path, log->snap_path) != 0) {
+    unlink(tmp_path);
+    return -1;
+  }
+  sync_parent(log->snap_path);
+
+  // The snapshot now holds everything in the log, so a new generation
+  // starts. Until the old log is gone recovery skips it by its mark; if it
+  // can not be emptied, later batches can not be put after it reliably.
+  if (ftruncate(log->fd, 0) != 0 || lseek(log->fd, 0, SEEK_SET) < 0) {
+    log->failed = 1;
+    return -1;
+  }
+  log->generation++;
+  log->end = 0;
+  fdatasync(log->fd);
+  return 0;
+}
+
+int store_log_close(store_log* log) {
+  int result;
+
+  if (log == NULL) {
+    return 0;
+  }
+  result = store_log_commit(log);
+  store_attach_log(log->s, NULL);
+  if (close(log->fd) != 0) {
+    result = -1;
+  }
+  free(log);
+  return result;
+}
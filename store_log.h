@@ -0,0 +1,54 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Crash-safe persistence for a store: an append-only log of aisle and
+ * stockroom writes plus snapshots. See store_log.c for details.
+ */
+
+#ifndef STORE_LOG_H
+#define STORE_LOG_H
+
+#include <stddef.h>
+
+#include "store.h"
+
+typedef struct store_log store_log;
+
+// store_log_open flag: make every commit durable with fdatasync
+#define STORE_LOG_SYNC 1
+
+/* Rebuilds the store saved under path: loads path.snap if it exists (else
+ * starts from num_aisles empty aisles) and replays path.log on top of it.
+ * Returns NULL if the snapshot is damaged or memory runs out. */
+store* store_log_recover(const char* path, size_t num_aisles);
+
+/* Opens path.log for appending, first cutting off any batch that a crash
+ * left half-written, and attaches it to s so every later aisle and
+ * stockroom write of s is logged. flags is 0 or STORE_LOG_SYNC. Returns NULL
+ * on failure. */
+store_log* store_log_open(const char* path, store* s, int flags);
+
+/* Writes all writes logged since the last commit to the log as one batch,
+ * and waits for it to reach the disk with STORE_LOG_SYNC. Returns 0 on
+ * success and -1 on an I/O error. After an error the log is missing writes
+ * the store has made, so this and every later commit, snapshot and close
+ * of the log return -1. */
+int store_log_commit(store_log* log);
+
+/* Saves the whole store to path.snap (atomically replacing the previous
+ * snapshot) and empties the log. Returns 0 on success and -1 on failure. If
+ * the new snapshot could not be saved, the old snapshot and log are still
+ * intact; if the log could not be emptied after it, recovery still skips what
+ * the snapshot holds, but the log is failed as after a failed commit. */
+int store_log_snapshot(store_log* log);
+
+/* Commits, detaches the log from its store and closes it. Returns 0 on
+ * success and -1 if the log is missing any write of the store. */
+int store_log_close(store_log* log);
+
+/* Called by store.c for every aisle / stockroom write of the store the log
+ * is attached to. Commits by itself when its buffer is full. */
+void store_log_aisle(store_log* log, size_t i, unsigned long aisle);
+void store_log_stock(store_log* log, unsigned short id, int count);
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * Store-wide queries that look at whole aisles at a time instead of calling
+ * get_id and num_items once per section. See aisle_manager.c for the aisle
+ * layout.
+ *
+ * Since a section is a 16-bit lane of its aisle, the four sections of an
+ * aisle can be examined together with SWAR ("SIMD within a register") tricks
+ * on the 64-bit word:
+ *
+ *   - A section is empty and has id X exactly when the whole section equals
+ *     X << 10, so empty_section_with_id becomes "find a 16-bit lane equal to
+ *     a constant", which is a zero-lane test on (aisle ^ pattern).
+ *   - The item counts of all four sections are a lane-wise popcount of
+ *     (aisle & spaces mask), done with the usual shift/mask/add ladder.
+ *
+ * The lane helpers are in aisle_word.h.
+ *
+ * With AVX2 four aisles (16 sections) are handled per 256-bit register. Both
+ * queries scan in increasing address order and stop at the first lane that
+ * settles the answer, so ties still go to the lowest address. As in
+ * store_client.c, section j of an aisle is taken to be the j-th short in
+ * memory, i.e. the aisles are stored little-endian.
+ */
+
+#include <stdint.h>
+
+#include "aisle_word.h"
+#include "store_query.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+unsigned short* bulk_empty_section_with_id(unsigned long* aisles,
+                                           size_t num_aisles,
+                                           unsigned short id) {
+  uint64_t pattern = ((uint64_t) id << 10) * AISLE_LANE_LOW;
+  size_t i = 0;
+
+  if (id >> 6) {
+    // No section can hold an id wider than 6 bits
+    return NULL;
+  }
+
+#ifdef __AVX2__
+  __m256i target = _mm256_set1_epi16((short)(id << 10));
+  for (; i + 4 <= num_aisles; i += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(aisles + i));
+    unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi16(v, target));
+    if (mask != 0) {
+      // Two mask bits per 16-bit lane, lanes in address order
+      return (unsigned short*)(aisles + i) + __builtin_ctz(mask) / 2;
+    }
+  }
+#endif
+
+  for (; i < num_aisles; i++) {
+    uint64_t zero = aisle_lane_zero(aisles[i] ^ pattern);
+    if (zero != 0) {
+      return (unsigned short*)(aisles + i) + aisle_lowest_lane(zero);
+    }
+  }
+  return NULL;
+}
+
+
+/*
+ * scan_aisle - Updates (*best, *best_section) with any section of aisle i that
+ *     holds more than *best items, scanning in address order.
+ */
+static inline void scan_aisle(unsigned long* aisles, size_t i, int* best,
+                              unsigned short** best_section) {
+  uint64_t counts = aisle_counts(aisles[i]);
+  for (int j = 0; j < AISLE_SECTIONS; j++) {
+    int items = aisle_lane(counts, j);
+    if (items > *best) {
+      *best = items;
+      *best_section = (unsigned short*)(aisles + i) + j;
+    }
+  }
+}
+
+unsigned short* bulk_section_with_most_items(unsigned long* aisles,
+                                             size_t num_aisles) {
+  unsigned short* best_section = (unsigned short*) aisles;
+  int best = 0;
+  size_t i = 0;
+
+  if (num_aisles == 0) {
+    return NULL;
+  }
+
+#ifdef __AVX2__
+  // Per-nibble popcounts, for _mm256_shuffle_epi8
+  const __m256i nibble_counts = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+  const __m256i spaces = _mm256_set1_epi16(0x03FF);
+  const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+  for (; i + 4 <= num_aisles && best < AISLE_MAX_ITEMS; i += 4) {
+    __m256i v = _mm256_and_si256(
+        _mm256_loadu_si256((const __m256i*)(aisles + i)), spaces);
+    __m256i per_byte = _mm256_add_epi8(
+        _mm256_shuffle_epi8(nibble_counts, _mm256_and_si256(v, low_nibble)),
+        _mm256_shuffle_epi8(nibble_counts,
+                            _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble)));
+    __m256i counts = _mm256_add_epi16(_mm256_and_si256(per_byte, low_byte),
+                                      _mm256_srli_epi16(per_byte, 8));
+    // Only look closer at blocks holding a section that beats the best
+    if (_mm256_movemask_epi8(_mm256_cmpgt_epi16(counts, _mm256_set1_epi16((short) best)))) {
+      for (size_t k = i; k < i + 4; k++) {
+        scan_aisle(aisles, k, &best, &best_section);
+      }
+    }
+  }
+#endif
+
+  // A full section can not be beaten, and ties keep the lower address
+  for (; i < num_aisles && best < AISLE_MAX_ITEMS; i++) {
+    uint64_t counts = aisle_counts(aisles[i]);
+    // Lane j of counts + (0x7FFF - best) has its high bit set iff lane j > best
+    if (((counts + (uint64_t)(0x7FFF - best) * AISLE_LANE_LOW) & AISLE_LANE_HIGH) != 0) {
+      scan_aisle(aisles, i, &best, &best_section);
+    }
+  }
+  return best_section;
+}
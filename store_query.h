@@ -0,0 +1,26 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Bulk queries over an array of aisles. See store_query.c for details.
+ */
+
+#ifndef STORE_QUERY_H
+#define STORE_QUERY_H
+
+#include <stddef.h>
+
+/* Return a pointer to the lowest-addressed section in aisles[0..num_aisles)
+ * with the given item id that has no items in it, or NULL if there is none.
+ * Same answer as empty_section_with_id in store_client.c. */
+unsigned short* bulk_empty_section_with_id(unsigned long* aisles,
+                                           size_t num_aisles,
+                                           unsigned short id);
+
+/* Return a pointer to the lowest-addressed section in aisles[0..num_aisles)
+ * holding the most items (section 0 of aisle 0 if every section is empty).
+ * Same answer as section_with_most_items in store_client.c. Returns NULL only
+ * if num_aisles is 0. */
+unsigned short* bulk_section_with_most_items(unsigned long* aisles,
+                                             size_t num_aisles);
+
+#endif
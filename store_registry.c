@@ -0,0 +1,516 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Name(s): Joban Mand, Smayan Nirantare
+ * NetID(s): jmand1, smayan
+ *
+ * store_client.c has one global store. A registry holds thousands of
+ * independent stores in one process, each with its own aisles, stockroom and
+ * lock, and routes every operation to a store by its id:
+ *
+ *   - Store ids are indexes into an array of slots allocated once for the
+ *     registry's capacity, so looking a store up is one bounds check and an
+ *     index, and slots never move while other threads use them. Each slot is
+ *     a cache line of its own, so threads locking neighboring stores do not
+ *     share lines.
+ *   - A store is either an indexed store.c store, or, with REGISTRY_COMPACT,
+ *     a single allocation of its stockroom followed by its aisles. A store.c
+ *     store's indexes take about as much memory again as its aisles plus
+ *     dozens of small allocations, which dominates for small stores; a
+ *     compact store costs its aisles and 256 bytes. Compact stores run the
+ *     store_client.c algorithms over their aisles, a whole aisle at a time
+ *     (see aisle_word.h), skipping aisles with nothing to take or no room.
+ *   - registry_run spreads a list of refill and fulfill jobs over threads.
+ *     The jobs are grouped by store (keeping their order within a store) and
+ *     each thread claims a whole store's group at a time, so every store's
+ *     jobs run in order on one thread, different stores run in parallel, and
+ *     the store locks are only contended by callers outside the run.
+ *
+ * Build (store.c refers to the log and analytics hooks, so those files are
+ * needed even if the program never uses them):
+ *   gcc -O2 -std=gnu99 -pthread -o prog prog.c store_registry.c store.c \
+ *       store_log.c store_query.c store_analytics.c aisle_manager.c bitset.c
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aisle_manager.h"
+#include "aisle_word.h"
+#include "store_query.h"
+#include "store_registry.h"
+
+// Maximum number of threads registry_run uses
+#define MAX_THREADS 64
+
+struct compact_store {
+  size_t num_aisles;
+  int stockroom[STORE_NUM_ITEMS];
+  unsigned long aisles[];
+};
+
+struct slot {
+  pthread_mutex_t lock;
+  store* full;                        // the store, if it is indexed
+  struct compact_store* compact;      // the store, if it is compact
+} __attribute__((aligned(64)));
+
+struct store_registry {
+  struct slot* slots;
+  int max_stores;
+  int num_stores;                     // slots [0, num_stores) are in use
+  pthread_mutex_t add_lock;
+};
+
+// A registry_run in progress
+struct run {
+  store_registry* r;
+  struct registry_job* jobs;
+  const size_t* order;                // job indexes grouped by store
+  const size_t* group_starts;         // where each group starts in order
+  size_t num_groups;
+  size_t next;                        // next group to claim
+};
+
+
+store_registry* registry_create(int max_stores) {
+  store_registry* r;
+
+  if (max_stores <= 0) {
+    return NULL;
+  }
+  r = calloc(1, sizeof(*r));
+  if (r == NULL) {
+    return NULL;
+  }
+  if (posix_memalign((void**) &r->slots, 64,
+                     sizeof(struct slot) * (size_t) max_stores) != 0) {
+    free(r);
+    return NULL;
+  }
+  r->max_stores = max_stores;
+  pthread_mutex_init(&r->add_lock, NULL);
+  return r;
+}
+
+void registry_destroy(store_registry* r) {
+  if (r == NULL) {
+    return;
+  }
+  for (int k = 0; k < r->num_stores; k++) {
+    store_destroy(r->slots[k].full);
+    free(r->slots[k].compact);
+    pthread_mutex_destroy(&r->slots[k].lock);
+  }
+  pthread_mutex_destroy(&r->add_lock);
+  free(r->slots);
+  free(r);
+}
+
+int registry_add_store(store_registry* r, size_t num_aisles, int flags) {
+  store* full = NULL;
+  struct compact_store* compact = NULL;
+  int store_id = -1;
+
+  if (num_aisles == 0) {
+    return -1;
+  }
+  if (flags & REGISTRY_COMPACT) {
+    compact = calloc(1, sizeof(*compact) + num_aisles * sizeof(unsigned long));
+    if (compact == NULL) {
+      return -1;
+    }
+    compact->num_aisles = num_aisles;
+  } else {
+    full = store_create(num_aisles);
+    if (full == NULL) {
+      return -1;
+    }
+  }
+
+  pthread_mutex_lock(&r->add_lock);
+  if (r->num_stores < r->max_stores) {
+    struct slot* slot = &r->slots[r->num_stores];
+    pthread_mutex_init(&slot->lock, NULL);
+    slot->full = full;
+    slot->compact = compact;
+    store_id = r->num_stores;
+    // Publish the slot only once it is filled in
+    __atomic_store_n(&r->num_stores, store_id + 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&r->add_lock);
+
+  if (store_id < 0) {
+    store_destroy(full);
+    free(compact);
+  }
+  return store_id;
+}
+
+int registry_num_stores(const store_registry* r) {
+  return __atomic_load_n(&r->num_stores, __ATOMIC_ACQUIRE);
+}
+
+/* Returns the slot of store_id, locked, or NULL if there is no such store. */
+static struct slot* lock_store(store_registry* r, int store_id) {
+  struct slot* slot;
+
+  if (store_id < 0 || store_id >= registry_num_stores(r)) {
+    return NULL;
+  }
+  slot = &r->slots[store_id];
+  pthread_mutex_lock(&slot->lock);
+  return slot;
+}
+
+static void unlock_store(struct slot* slot) {
+  pthread_mutex_unlock(&slot->lock);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Compact stores
+ * ----------------------------------------------------------------------------
+ */
+
+/* refill_from_stockroom in store_client.c, skipping full aisles. */
+static void compact_refill(struct compact_store* c) {
+  for (size_t i = 0; i < c->num_aisles; i++) {
+    unsigned long aisle = c->aisles[i];
+    uint64_t ids, room;
+    uint64_t amounts = 0;
+    if ((aisle & AISLE_LANE_SPACES) == AISLE_LANE_SPACES) {
+      continue;
+    }
+    ids = aisle_ids(aisle);
+    room = aisle_room(aisle);
+    for (int j = 0; j < AISLE_SECTIONS; j++) {
+      int id = aisle_lane(ids, j);
+      int items_to_add = aisle_lane(room, j);
+      if (c->stockroom[id] < items_to_add) {
+        items_to_add = c->stockroom[id];
+      }
+      if (items_to_add > 0) {
+        c->stockroom[id] -= items_to_add;
+        amounts |= (uint64_t) items_to_add << (16 * j);
+      }
+    }
+    if (amounts != 0) {
+      c->aisles[i] = aisle_fill(aisle, amounts);
+    }
+  }
+}
+
+/* fulfill_order in store_client.c (the stockroom is only drawn on while it
+ * is positive, as in store.c), skipping aisles without any items. */
+static int compact_fulfill(struct compact_store* c, unsigned short id,
+                           int num) {
+  int items_removed = 0;
+
+  if (id >= STORE_NUM_ITEMS || num <= 0) {
+    return 0;
+  }
+  for (size_t i = 0; i < c->num_aisles && items_removed < num; i++) {
+    unsigned long aisle = c->aisles[i];
+    if ((aisle & AISLE_LANE_SPACES) == 0) {
+      continue;
+    }
+    for (int j = 0; j < AISLE_SECTIONS && items_removed < num; j++) {
+      if (get_id(&aisle, j) == id) {
+        int num_to_remove = num_items(&aisle, j);
+        if (num - items_removed < num_to_remove) {
+          num_to_remove = num - items_removed;
+        }
+        remove_items(&aisle, j, num_to_remove);
+        items_removed += num_to_remove;
+      }
+    }
+    c->aisles[i] = aisle;
+  }
+  if (items_removed < num && c->stockroom[id] > 0) {
+    int from_stock = num - items_removed;
+    if (c->stockroom[id] < from_stock) {
+      from_stock = c->stockroom[id];
+    }
+    c->stockroom[id] -= from_stock;
+    items_removed += from_stock;
+  }
+  return items_removed;
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Routed operations
+ * ----------------------------------------------------------------------------
+ */
+
+/* Returns the aisles and number of aisles of the store in a slot. */
+static const unsigned long* slot_aisles(const struct slot* slot,
+                                        size_t* num_aisles) {
+  if (slot->full != NULL) {
+    *num_aisles = store_num_aisles(slot->full);
+    return store_aisles(slot->full);
+  }
+  *num_aisles = slot->compact->num_aisles;
+  return slot->compact->aisles;
+}
+
+size_t registry_num_aisles(store_registry* r, int store_id) {
+  // The size of a store never changes, so no lock is needed
+  size_t num_aisles = 0;
+  if (store_id >= 0 && store_id < registry_num_stores(r)) {
+    slot_aisles(&r->slots[store_id], &num_aisles);
+  }
+  return num_aisles;
+}
+
+int registry_get_aisle(store_registry* r, int store_id, size_t i,
+                       unsigned long* aisle) {
+  struct slot* slot = lock_store(r, store_id);
+  size_t num_aisles;
+  const unsigned long* a;
+  int result = -1;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  a = slot_aisles(slot, &num_aisles);
+  if (i < num_aisles) {
+    *aisle = a[i];
+    result = 0;
+  }
+  unlock_store(slot);
+  return result;
+}
+
+int registry_set_aisle(store_registry* r, int store_id, size_t i,
+                       unsigned long aisle) {
+  struct slot* slot = lock_store(r, store_id);
+  int result = -1;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  if (slot->full != NULL && i < store_num_aisles(slot->full)) {
+    store_set_aisle(slot->full, i, aisle);
+    result = 0;
+  } else if (slot->compact != NULL && i < slot->compact->num_aisles) {
+    slot->compact->aisles[i] = aisle;
+    result = 0;
+  }
+  unlock_store(slot);
+  return result;
+}
+
+int registry_get_stock(store_registry* r, int store_id, unsigned short id) {
+  struct slot* slot = lock_store(r, store_id);
+  int count;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  if (slot->full != NULL) {
+    count = store_get_stock(slot->full, id);
+  } else {
+    count = id < STORE_NUM_ITEMS ? slot->compact->stockroom[id] : 0;
+  }
+  unlock_store(slot);
+  return count;
+}
+
+int registry_set_stock(store_registry* r, int store_id, unsigned short id,
+                       int count) {
+  struct slot* slot = lock_store(r, store_id);
+
+  if (slot == NULL) {
+    return -1;
+  }
+  if (slot->full != NULL) {
+    store_set_stock(slot->full, id, count);
+  } else if (id < STORE_NUM_ITEMS) {
+    slot->compact->stockroom[id] = count;
+  }
+  unlock_store(slot);
+  return 0;
+}
+
+int registry_refill_from_stockroom(store_registry* r, int store_id) {
+  struct slot* slot = lock_store(r, store_id);
+
+  if (slot == NULL) {
+    return -1;
+  }
+  if (slot->full != NULL) {
+    store_refill_from_stockroom(slot->full);
+  } else {
+    compact_refill(slot->compact);
+  }
+  unlock_store(slot);
+  return 0;
+}
+
+int registry_fulfill_order(store_registry* r, int store_id, unsigned short id,
+                           int num) {
+  struct slot* slot = lock_store(r, store_id);
+  int items_removed;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  if (slot->full != NULL) {
+    items_removed = store_fulfill_order(slot->full, id, num);
+  } else {
+    items_removed = compact_fulfill(slot->compact, id, num);
+  }
+  unlock_store(slot);
+  return items_removed;
+}
+
+long registry_empty_section_with_id(store_registry* r, int store_id,
+                                    unsigned short id) {
+  struct slot* slot = lock_store(r, store_id);
+  size_t num_aisles;
+  unsigned long* a;
+  unsigned short* section;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  a = (unsigned long*) slot_aisles(slot, &num_aisles);
+  if (slot->full != NULL) {
+    section = store_empty_section_with_id(slot->full, id);
+  } else {
+    section = bulk_empty_section_with_id(a, num_aisles, id);
+  }
+  unlock_store(slot);
+  return section == NULL ? -1 : (long)(section - (unsigned short*) a);
+}
+
+long registry_section_with_most_items(store_registry* r, int store_id) {
+  struct slot* slot = lock_store(r, store_id);
+  size_t num_aisles;
+  unsigned long* a;
+  unsigned short* section;
+
+  if (slot == NULL) {
+    return -1;
+  }
+  a = (unsigned long*) slot_aisles(slot, &num_aisles);
+  if (slot->full != NULL) {
+    section = store_section_with_most_items(slot->full);
+  } else {
+    section = bulk_section_with_most_items(a, num_aisles);
+  }
+  unlock_store(slot);
+  return (long)(section - (unsigned short*) a);
+}
+
+
+/*
+ * ----------------------------------------------------------------------------
+ * Worker pool
+ * ----------------------------------------------------------------------------
+ */
+
+static int run_job(store_registry* r, const struct registry_job* job) {
+  switch (job->kind) {
+    case REGISTRY_REFILL:
+      return registry_refill_from_stockroom(r, job->store_id);
+    case REGISTRY_FULFILL:
+      return registry_fulfill_order(r, job->store_id, job->id, job->num);
+    default:
+      return -1;
+  }
+}
+
+static void* run_worker(void* arg) {
+  struct run* run = arg;
+  size_t g;
+
+  while ((g = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) <
+         run->num_groups) {
+    for (size_t k = run->group_starts[g]; k < run->group_starts[g + 1]; k++) {
+      struct registry_job* job = &run->jobs[run->order[k]];
+      job->result = run_job(run->r, job);
+    }
+  }
+  return NULL;
+}
+
+void registry_run(store_registry* r, struct registry_job* jobs, size_t count,
+                  int num_threads) {
+  int num_stores = registry_num_stores(r);
+  size_t* first = calloc((size_t) num_stores + 1, sizeof(size_t));
+  size_t* order = malloc(count * sizeof(size_t));
+  size_t* group_starts = malloc(((size_t) num_stores + 1) * sizeof(size_t));
+  pthread_t threads[MAX_THREADS];
+  struct run run;
+  int started = 0;
+
+  if (first == NULL || order == NULL || group_starts == NULL) {
+    // Same results, on this thread only
+    for (size_t k = 0; k < count; k++) {
+      jobs[k].result = run_job(r, &jobs[k]);
+    }
+    free(first);
+    free(order);
+    free(group_starts);
+    return;
+  }
+
+  // Counting sort of the jobs by store, keeping their order within a store;
+  // jobs for unknown stores fail right away
+  for (size_t k = 0; k < count; k++) {
+    if (jobs[k].store_id >= 0 && jobs[k].store_id < num_stores) {
+      first[jobs[k].store_id + 1]++;
+    } else {
+      jobs[k].result = -1;
+    }
+  }
+  run.num_groups = 0;
+  group_starts[0] = 0;
+  for (int id = 0; id < num_stores; id++) {
+    if (first[id + 1] > 0) {
+      run.num_groups++;
+      group_starts[run.num_groups] = group_starts[run.num_groups - 1] + first[id + 1];
+    }
+    first[id + 1] += first[id];
+  }
+  for (size_t k = 0; k < count; k++) {
+    if (jobs[k].store_id >= 0 && jobs[k].store_id < num_stores) {
+      order[first[jobs[k].store_id]++] = k;
+    }
+  }
+
+  run.r = r;
+  run.jobs = jobs;
+  run.order = order;
+  run.group_starts = group_starts;
+  run.next = 0;
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+  if ((size_t) num_threads > run.num_groups) {
+    num_threads = (int) run.num_groups;
+  }
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+  for (int t = 1; t < num_threads; t++) {
+    if (pthread_create(&threads[started], NULL, run_worker, &run) != 0) {
+      break;
+    }
+    started++;
+  }
+  run_worker(&run);
+  for (int t = 0; t < started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+
+  free(first);
+  free(order);
+  free(group_starts);
+}
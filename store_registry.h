@@ -0,0 +1,79 @@
+/*
+ * CSE 351 Lab 1b (Manipulating Bits in C)
+ *
+ * Many independent stores in one process, addressed by store id. See
+ * store_registry.c for details.
+ */
+
+#ifndef STORE_REGISTRY_H
+#define STORE_REGISTRY_H
+
+#include <stddef.h>
+
+#include "store.h"
+
+typedef struct store_registry store_registry;
+
+// registry_add_store flags: keep only the aisles and stockroom, no indexes
+#define REGISTRY_COMPACT 1
+
+enum registry_job_kind {
+  REGISTRY_REFILL,          // refill_from_stockroom
+  REGISTRY_FULFILL          // fulfill_order(id, num)
+};
+
+struct registry_job {
+  int store_id;
+  enum registry_job_kind kind;
+  unsigned short id;
+  int num;
+  int result;               // set by registry_run: items removed, or -1
+};
+
+/* Creates a registry with room for max_stores stores. Returns NULL if
+ * max_stores is not positive or memory runs out. */
+store_registry* registry_create(int max_stores);
+
+/* Frees a registry and all of its stores. No other thread may be using it. */
+void registry_destroy(store_registry* r);
+
+/* Adds a store with num_aisles empty aisles and an empty stockroom, and
+ * returns its store id (0, 1, 2, ... in the order stores are added), or -1 if
+ * the registry is full, num_aisles is 0 or memory runs out. With
+ * REGISTRY_COMPACT the store is just its aisles and stockroom, at the cost
+ * of scanning every aisle on orders; otherwise it is an indexed store.c
+ * store. Safe to call while other threads use the registry. */
+int registry_add_store(store_registry* r, size_t num_aisles, int flags);
+
+/* Returns the number of stores in the registry. */
+int registry_num_stores(const store_registry* r);
+
+/* The store_client.c operations on store store_id, each done while holding
+ * that store's lock, so any thread may call them on any store. Sections are
+ * returned as positions (aisle * 4 + section) since the aisles may change as
+ * soon as the lock is released. registry_num_aisles returns 0 and the
+ * others -1 for an unknown store id or an out-of-range aisle. */
+size_t registry_num_aisles(store_registry* r, int store_id);
+int registry_get_aisle(store_registry* r, int store_id, size_t i,
+                       unsigned long* aisle);
+int registry_set_aisle(store_registry* r, int store_id, size_t i,
+                       unsigned long aisle);
+int registry_get_stock(store_registry* r, int store_id, unsigned short id);
+int registry_set_stock(store_registry* r, int store_id, unsigned short id,
+                       int count);
+int registry_refill_from_stockroom(store_registry* r, int store_id);
+int registry_fulfill_order(store_registry* r, int store_id, unsigned short id,
+                           int num);
+long registry_empty_section_with_id(store_registry* r, int store_id,
+                                    unsigned short id);
+long registry_section_with_most_items(store_registry* r, int store_id);
+
+/* Runs jobs[0..count) on up to num_threads threads, including the calling
+ * one, and stores each job's result in it. Different stores run in
+ * parallel; the jobs of one store run in the order they are listed, so the
+ * results are the same as running the jobs one after another. num_threads
+ * below 1 means 1. */
+void registry_run(store_registry* r, struct registry_job* jobs, size_t count,
+                  int num_threads);
+
+#endif
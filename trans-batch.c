@@ -0,0 +1,213 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 2 - Batched Transpose of Small Matrices
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Transposing many tiny matrices one call at a time spends most of its time
+ * on loop setup and on the getR() calls in the loop bounds of
+ * transpose_submit. transpose_batch() instead takes a contiguous array of
+ * same-shaped matrices and picks a kernel once for the whole batch.
+ *
+ * Kernels exist for every shape M x N with M, N in {4, 8, 16, 32}. Each one is
+ * generated by DEFINE_KERNEL with the shape as compile-time constants and is
+ * fully unrolled into 4x4 block transposes. With SSE2 a 4x4 block is four
+ * loads, eight unpacks and four stores, all in registers. The matrices are so
+ * small that a whole A and B fit in L1 together, so no further tiling is
+ * needed inside a kernel.
+ *
+ * Large batches are divided into contiguous chunks, one per thread.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "trans-batch.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Maximum number of worker threads
+#define MAX_THREADS 64
+
+// Batches with fewer bytes than this are not worth waking up threads for
+#define MIN_PARALLEL_BYTES (256 * 1024)
+
+// Forces full unrolling of the constant-trip block loops in the kernels
+#if defined(__GNUC__)
+#define UNROLL_ALL _Pragma("GCC unroll 64")
+#else
+#define UNROLL_ALL
+#endif
+
+typedef void (*batch_kernel_t)(const int* A, int* B);
+
+struct batch_job {
+  const int* A;
+  int* B;
+  int count;
+  int M;
+  int N;
+  batch_kernel_t kernel;
+};
+
+
+/*
+ * transpose_4x4 - Transposes the 4x4 block at a (row stride lda) into the 4x4
+ *     block at b (row stride ldb).
+ */
+static inline void transpose_4x4(const int* a, int lda, int* b, int ldb) {
+#ifdef __SSE2__
+  __m128i r0 = _mm_loadu_si128((const __m128i*)(a));
+  __m128i r1 = _mm_loadu_si128((const __m128i*)(a + lda));
+  __m128i r2 = _mm_loadu_si128((const __m128i*)(a + 2 * lda));
+  __m128i r3 = _mm_loadu_si128((const __m128i*)(a + 3 * lda));
+  // Interleave pairs of rows: t0 = a00 a10 a01 a11, t1 = a20 a30 a21 a31, ...
+  __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+  __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+  __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+  __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+  // Then pairs of pairs, giving the columns of the block
+  _mm_storeu_si128((__m128i*)(b), _mm_unpacklo_epi64(t0, t1));
+  _mm_storeu_si128((__m128i*)(b + ldb), _mm_unpackhi_epi64(t0, t1));
+  _mm_storeu_si128((__m128i*)(b + 2 * ldb), _mm_unpacklo_epi64(t2, t3));
+  _mm_storeu_si128((__m128i*)(b + 3 * ldb), _mm_unpackhi_epi64(t2, t3));
+#else
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      b[j * ldb + i] = a[i * lda + j];
+    }
+  }
+#endif
+}
+
+
+// Generates trans_MxN(), transposing one M x N matrix into an N x M one.
+#define DEFINE_KERNEL(M, N)                                                   \
+  static void trans_##M##x##N(const int* A, int* B) {                         \
+    UNROLL_ALL                                                                \
+    for (int i = 0; i < M; i += 4) {                                          \
+      UNROLL_ALL                                                              \
+      for (int j = 0; j < N; j += 4) {                                        \
+        transpose_4x4(A + i * N + j, N, B + j * M + i, M);                    \
+      }                                                                       \
+    }                                                                         \
+  }
+
+DEFINE_KERNEL(4, 4)   DEFINE_KERNEL(4, 8)   DEFINE_KERNEL(4, 16)   DEFINE_KERNEL(4, 32)
+DEFINE_KERNEL(8, 4)   DEFINE_KERNEL(8, 8)   DEFINE_KERNEL(8, 16)   DEFINE_KERNEL(8, 32)
+DEFINE_KERNEL(16, 4)  DEFINE_KERNEL(16, 8)  DEFINE_KERNEL(16, 16)  DEFINE_KERNEL(16, 32)
+DEFINE_KERNEL(32, 4)  DEFINE_KERNEL(32, 8)  DEFINE_KERNEL(32, 16)  DEFINE_KERNEL(32, 32)
+
+// Indexed by [side_index(M)][side_index(N)]
+static const batch_kernel_t kernels[4][4] = {
+  {trans_4x4,  trans_4x8,  trans_4x16,  trans_4x32},
+  {trans_8x4,  trans_8x8,  trans_8x16,  trans_8x32},
+  {trans_16x4, trans_16x8, trans_16x16, trans_16x32},
+  {trans_32x4, trans_32x8, trans_32x16, trans_32x32},
+};
+
+
+/* Returns the kernel table index for a matrix side, or -1 if there is none. */
+static int side_index(int side) {
+  switch (side) {
+    case 4:  return 0;
+    case 8:  return 1;
+    case 16: return 2;
+    case 32: return 3;
+    default: return -1;
+  }
+}
+
+
+/* Transposes every matrix of a job, with the job's kernel if it has one. */
+static void run_job(const struct batch_job* job) {
+  int M = job->M;
+  int N = job->N;
+  long size = (long) M * N;
+  const int* A = job->A;
+  int* B = job->B;
+
+  if (job->kernel != NULL) {
+    for (int k = 0; k < job->count; k++) {
+      job->kernel(A + k * size, B + k * size);
+    }
+    return;
+  }
+
+  for (int k = 0; k < job->count; k++) {
+    const int* a = A + k * size;
+    int* b = B + k * size;
+    for (int i = 0; i < M; i++) {
+      for (int j = 0; j < N; j++) {
+        b[j * M + i] = a[i * N + j];
+      }
+    }
+  }
+}
+
+static void* job_thread(void* arg) {
+  run_job((const struct batch_job*) arg);
+  return NULL;
+}
+
+
+int transpose_batch(int count, int M, int N, const int* A, int* B,
+                    int num_threads) {
+  struct batch_job jobs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+  long size = (long) M * N;
+  int mi = side_index(M);
+  int ni = side_index(N);
+  batch_kernel_t kernel = (mi >= 0 && ni >= 0) ? kernels[mi][ni] : NULL;
+  int started = 0;
+  int ret = 0;
+
+  if (count <= 0 || size <= 0) {
+    return 0;
+  }
+
+  if (num_threads <= 0) {
+    num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (num_threads > MAX_THREADS) {
+    num_threads = MAX_THREADS;
+  }
+  if (num_threads > count) {
+    num_threads = count;
+  }
+  if (num_threads < 1 || count * size * (long) sizeof(int) < MIN_PARALLEL_BYTES) {
+    num_threads = 1;
+  }
+
+  // Contiguous chunks, the first (count % num_threads) get one extra matrix
+  for (int t = 0, first = 0; t < num_threads; t++) {
+    int n = count / num_threads + (t < count % num_threads);
+    jobs[t].A = A + first * size;
+    jobs[t].B = B + first * size;
+    jobs[t].count = n;
+    jobs[t].M = M;
+    jobs[t].N = N;
+    jobs[t].kernel = kernel;
+    first += n;
+  }
+
+  // Job 0 runs on the calling thread; the rest get their own threads
+  for (int t = 1; t < num_threads; t++) {
+    if (pthread_create(&threads[t], NULL, job_thread, &jobs[t]) != 0) {
+      ret = -1;
+      break;
+    }
+    started = t;
+  }
+  run_job(&jobs[0]);
+  for (int t = started + 1; t < num_threads; t++) {
+    run_job(&jobs[t]);
+  }
+  for (int t = 1; t <= started; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  return ret;
+}
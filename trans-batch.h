@@ -0,0 +1,27 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 2 - Batched Transpose of Small Matrices
+ *
+ * See trans-batch.c for details.
+ */
+
+#ifndef TRANS_BATCH_H
+#define TRANS_BATCH_H
+
+/*
+ * transpose_batch - Transposes count matrices of shape M x N stored back to
+ *     back in A into count matrices of shape N x M stored back to back in B.
+ *     Shapes whose sides are 4, 8, 16 or 32 use fully unrolled kernels; any
+ *     other shape falls back to a generic loop.
+ *
+ *     The batch is split across num_threads threads (num_threads <= 0 means
+ *     one per online CPU). Small batches are always run on the calling thread.
+ *
+ *     Returns 0 on success and -1 if a worker thread could not be started (in
+ *     which case the remaining matrices are transposed on the calling thread,
+ *     so B is still complete).
+ */
+int transpose_batch(int count, int M, int N, const int* A, int* B,
+                    int num_threads);
+
+#endif
@@ -0,0 +1,459 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 2 - Transpose Benchmark Driver
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * The course driver only counts misses on the simulated 1 KiB cache. This
+ * driver stands in for it: it provides its own registerTransFunction(), calls
+ * registerFunctions() from trans.c, and then times every registered transpose
+ * on real memory over a sweep of matrix shapes. Shapes that are not powers of
+ * two (61x67, 255x257, ...) are included on purpose since they behave very
+ * differently with respect to conflict misses.
+ *
+ * For each function and shape it reports the best wall-clock time and the
+ * effective bandwidth (bytes read + bytes written per second). With -p it
+ * also reads hardware counters through perf_event_open(2): L1D read misses,
+ * LLC read misses and dTLB read misses, averaged per run.
+ *
+ * With -b COUNT it instead compares, for small square shapes, transposing a
+ * batch of COUNT matrices one transpose_submit call at a time against
+ * transpose_batch() from trans-batch.c, and reports matrices per second.
+ *
+ * Build (do NOT link the course's cachelab.c, this file replaces it):
+ *   gcc -O2 -std=gnu99 -pthread -o trans-bench trans-bench.c trans.c trans-batch.c
+ *
+ * Usage:
+ *   ./trans-bench [-p] [-r min_reps] [-s MxN]...
+ *   ./trans-bench -b count
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "trans-batch.h"
+
+// Maximum number of transpose functions that can be registered
+#define MAX_FUNCS 32
+
+// Maximum number of shapes in a sweep
+#define MAX_SHAPES 32
+
+// Extra rows/columns allocated around each matrix. transpose_submit works in
+// whole tiles (up to 8x8) and runs past the edge of shapes that are not a
+// multiple of the tile size, so the padding keeps those stray accesses inside
+// memory we own. Such runs are then reported as incorrect instead of crashing.
+#define PAD 8
+
+// Each measurement repeats the transpose until at least this many bytes have
+// been moved, so that small shapes are not dominated by timer resolution.
+#define MIN_BYTES_PER_SAMPLE (64L << 20)
+
+// Number of hardware counters read with -p
+#define NUM_COUNTERS 3
+
+// Timed samples per variant in batch mode (-b)
+#define BATCH_SAMPLES 5
+
+typedef void (*trans_fn_t)(int M, int N, int A[M][N], int B[N][M]);
+
+struct trans_func {
+  trans_fn_t fn;
+  char* desc;
+};
+
+struct shape {
+  int M;
+  int N;
+};
+
+// Functions registered through registerTransFunction()
+static struct trans_func funcs[MAX_FUNCS];
+static int num_funcs = 0;
+
+// Default sweep. Mixes the graded shapes, larger powers of two, and awkward
+// shapes whose row strides do not alias to the same cache sets.
+static const struct shape default_shapes[] = {
+  {32, 32}, {64, 64}, {61, 67}, {67, 61},
+  {256, 256}, {255, 257}, {512, 512}, {500, 500},
+  {1024, 1024}, {1000, 1000}, {2048, 2048}, {2047, 2049},
+};
+
+static const char* counter_names[NUM_COUNTERS] = {
+  "L1D-miss", "LLC-miss", "dTLB-miss"
+};
+
+// Square sides compared in batch mode (-b)
+static const int batch_sides[] = {4, 8, 16, 32};
+
+// Defined in trans.c
+void registerFunctions();
+void transpose_submit(int M, int N, int A[M][N], int B[N][M]);
+int is_transpose(int M, int N, int A[M][N], int B[N][M]);
+
+
+/*
+ * registerTransFunction - Replacement for the course driver's hook. Simply
+ *     records the function so that main can benchmark it.
+ */
+void registerTransFunction(trans_fn_t trans, char* desc) {
+  if (num_funcs == MAX_FUNCS) {
+    fprintf(stderr, "too many transpose functions, ignoring \"%s\"\n", desc);
+    return;
+  }
+  funcs[num_funcs].fn = trans;
+  funcs[num_funcs].desc = desc;
+  num_funcs++;
+}
+
+
+/* Returns the current monotonic time in seconds. */
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+#ifdef __linux__
+/* Opens one disabled, user-space-only hardware cache counter on this thread.
+ * Returns -1 if the counter is not available (no PMU, paranoid setting, VM).
+ */
+static int open_cache_counter(unsigned long cache, unsigned long op,
+                              unsigned long result) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.config = cache | (op << 8) | (result << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void open_counters(int fds[NUM_COUNTERS]) {
+  fds[0] = open_cache_counter(PERF_COUNT_HW_CACHE_L1D,
+                              PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS);
+  fds[1] = open_cache_counter(PERF_COUNT_HW_CACHE_LL,
+                              PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS);
+  fds[2] = open_cache_counter(PERF_COUNT_HW_CACHE_DTLB,
+                              PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS);
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    if (fds[i] < 0) {
+      fprintf(stderr, "warning: %s counter unavailable: %s\n",
+              counter_names[i], strerror(errno));
+    }
+  }
+}
+
+static void start_counters(int fds[NUM_COUNTERS]) {
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    if (fds[i] >= 0) {
+      ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+static void stop_counters(int fds[NUM_COUNTERS], long long values[NUM_COUNTERS]) {
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    values[i] = -1;
+    if (fds[i] >= 0) {
+      ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+        values[i] = -1;
+      }
+    }
+  }
+}
+#else
+static void open_counters(int fds[NUM_COUNTERS]) {
+  fprintf(stderr, "warning: hardware counters are only supported on Linux\n");
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    fds[i] = -1;
+  }
+}
+
+static void start_counters(int fds[NUM_COUNTERS]) { (void) fds; }
+
+static void stop_counters(int fds[NUM_COUNTERS], long long values[NUM_COUNTERS]) {
+  (void) fds;
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    values[i] = -1;
+  }
+}
+#endif
+
+
+/* Allocates a padded rows x cols matrix of ints (see PAD). */
+static int* alloc_matrix(int rows, int cols) {
+  size_t count = (size_t)(rows + PAD) * (cols + PAD);
+  int* m = malloc(count * sizeof(int));
+  if (m == NULL) {
+    fprintf(stderr, "out of memory allocating %dx%d matrix\n", rows, cols);
+    exit(EXIT_FAILURE);
+  }
+  memset(m, 0, count * sizeof(int));
+  return m;
+}
+
+
+/*
+ * bench_one - Times a single function on a single shape and prints one row of
+ *     the results table. Returns 0 if the function produced a wrong transpose.
+ */
+static int bench_one(struct trans_func* f, struct shape s, int min_reps,
+                     int use_counters, int fds[NUM_COUNTERS]) {
+  int M = s.M;
+  int N = s.N;
+  int* A = alloc_matrix(M, N);
+  int* B = alloc_matrix(N, M);
+  long bytes = 2L * M * N * sizeof(int);
+  long long totals[NUM_COUNTERS] = {0};
+  long long values[NUM_COUNTERS];
+  double best = -1;
+  int reps = (int)(MIN_BYTES_PER_SAMPLE / bytes);
+  int ok;
+
+  for (int i = 0; i < M * N; i++) {
+    A[i] = i;
+  }
+
+  // Warm-up run, also used for the correctness check
+  f->fn(M, N, (int (*)[N]) A, (int (*)[M]) B);
+  ok = is_transpose(M, N, (int (*)[N]) A, (int (*)[M]) B);
+  if (!ok) {
+    printf("%-32.32s %5dx%-5d %10s\n", f->desc, M, N, "incorrect");
+    free(A);
+    free(B);
+    return 0;
+  }
+
+  if (reps < 1) {
+    reps = 1;
+  }
+  for (int sample = 0; sample < min_reps; sample++) {
+    if (use_counters) {
+      start_counters(fds);
+    }
+    double start = now();
+    for (int r = 0; r < reps; r++) {
+      f->fn(M, N, (int (*)[N]) A, (int (*)[M]) B);
+    }
+    double elapsed = (now() - start) / reps;
+    if (use_counters) {
+      stop_counters(fds, values);
+      for (int i = 0; i < NUM_COUNTERS; i++) {
+        totals[i] = (values[i] < 0 || totals[i] < 0) ? -1 : totals[i] + values[i];
+      }
+    }
+    if (best < 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  printf("%-32.32s %5dx%-5d %10.2f %8.2f", f->desc, M, N, best * 1e6,
+         bytes / best / 1e9);
+  if (use_counters) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+      if (totals[i] < 0) {
+        printf(" %12s", "n/a");
+      } else {
+        printf(" %12.0f", (double) totals[i] / ((double) reps * min_reps));
+      }
+    }
+  }
+  printf("\n");
+
+  free(A);
+  free(B);
+  return 1;
+}
+
+
+/* Returns 1 if every matrix in B is the transpose of the one in A. */
+static int batch_correct(int count, int side, const int* A, const int* B) {
+  long size = (long) side * side;
+  for (int k = 0; k < count; k++) {
+    if (!is_transpose(side, side, (int (*)[side]) (A + k * size),
+                      (int (*)[side]) (B + k * size))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+ * bench_batch - Times one way of transposing a batch of count side x side
+ *     matrices (threads < 0 means one transpose_submit call per matrix) and
+ *     prints one row of the results table.
+ */
+static int bench_batch(const char* desc, int count, int side, int threads,
+                       const int* A, int* B) {
+  long size = (long) side * side;
+  double best = -1;
+
+  memset(B, 0, count * size * sizeof(int));
+  for (int sample = 0; sample < BATCH_SAMPLES; sample++) {
+    double start = now();
+    if (threads < 0) {
+      for (int k = 0; k < count; k++) {
+        transpose_submit(side, side, (int (*)[side]) (A + k * size),
+                         (int (*)[side]) (B + k * size));
+      }
+    } else {
+      transpose_batch(count, side, side, A, B, threads);
+    }
+    double elapsed = now() - start;
+    if (best < 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  if (!batch_correct(count, side, A, B)) {
+    printf("%-32.32s %5dx%-5d %10s\n", desc, side, side, "incorrect");
+    return 0;
+  }
+  printf("%-32.32s %5dx%-5d %10.2f %8.2f %12.3f\n", desc, side, side,
+         best * 1e6, 2.0 * count * size * sizeof(int) / best / 1e9,
+         count / best / 1e6);
+  return 1;
+}
+
+/* Batch mode: per-matrix calls vs. transpose_batch on small squares. */
+static int run_batch_mode(int count) {
+  int all_ok = 1;
+
+  printf("%-32s %11s %10s %8s %12s\n", "variant", "shape", "best(us)", "GB/s",
+         "Mmatrices/s");
+  for (size_t s = 0; s < sizeof(batch_sides) / sizeof(batch_sides[0]); s++) {
+    int side = batch_sides[s];
+    size_t total = (size_t) count * side * side;
+    int* A = malloc(total * sizeof(int));
+    int* B = malloc(total * sizeof(int));
+    if (A == NULL || B == NULL) {
+      fprintf(stderr, "out of memory allocating batch of %d\n", count);
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < total; i++) {
+      A[i] = (int) i;
+    }
+    all_ok &= bench_batch("transpose_submit per matrix", count, side, -1, A, B);
+    all_ok &= bench_batch("transpose_batch 1 thread", count, side, 1, A, B);
+    all_ok &= bench_batch("transpose_batch all threads", count, side, 0, A, B);
+    free(A);
+    free(B);
+  }
+  return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-p] [-r min_reps] [-s MxN]...\n", prog);
+  fprintf(stderr, "       %s -b count\n", prog);
+  fprintf(stderr, "\t-p\tread hardware cache/TLB miss counters\n");
+  fprintf(stderr, "\t-r\tnumber of timed samples per measurement (default 5)\n");
+  fprintf(stderr, "\t-s\tbenchmark an MxN shape instead of the default sweep;\n");
+  fprintf(stderr, "\t\tmay be given multiple times\n");
+  fprintf(stderr, "\t-b\tcompare batched and per-matrix transposes of count\n");
+  fprintf(stderr, "\t\tsmall square matrices\n");
+}
+
+
+int main(int argc, char* argv[]) {
+  struct shape shapes[MAX_SHAPES];
+  int num_shapes = 0;
+  int use_counters = 0;
+  int min_reps = 5;
+  int fds[NUM_COUNTERS];
+  int all_ok = 1;
+  int batch_count = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "pr:s:b:h")) != -1) {
+    switch (opt) {
+      case 'b':
+        batch_count = atoi(optarg);
+        if (batch_count < 1) {
+          fprintf(stderr, "batch count must be positive\n");
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'p':
+        use_counters = 1;
+        break;
+      case 'r':
+        min_reps = atoi(optarg);
+        if (min_reps < 1) {
+          min_reps = 1;
+        }
+        break;
+      case 's':
+        if (num_shapes == MAX_SHAPES) {
+          fprintf(stderr, "too many shapes (max %d)\n", MAX_SHAPES);
+          return EXIT_FAILURE;
+        }
+        if (sscanf(optarg, "%dx%d", &shapes[num_shapes].M,
+                   &shapes[num_shapes].N) != 2 ||
+            shapes[num_shapes].M <= 0 || shapes[num_shapes].N <= 0) {
+          fprintf(stderr, "bad shape \"%s\", expected MxN\n", optarg);
+          return EXIT_FAILURE;
+        }
+        num_shapes++;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (batch_count > 0) {
+    return run_batch_mode(batch_count);
+  }
+
+  if (num_shapes == 0) {
+    num_shapes = sizeof(default_shapes) / sizeof(default_shapes[0]);
+    memcpy(shapes, default_shapes, sizeof(default_shapes));
+  }
+
+  registerFunctions();
+  if (num_funcs == 0) {
+    printf("No transpose functions registered!\n");
+    return EXIT_FAILURE;
+  }
+
+  if (use_counters) {
+    open_counters(fds);
+  }
+
+  printf("%-32s %11s %10s %8s", "function", "shape", "best(us)", "GB/s");
+  if (use_counters) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+      printf(" %12s", counter_names[i]);
+    }
+  }
+  printf("\n");
+
+  for (int s = 0; s < num_shapes; s++) {
+    for (int f = 0; f < num_funcs; f++) {
+      all_ok &= bench_one(&funcs[f], shapes[s], min_reps, use_counters, fds);
+    }
+  }
+
+  return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,402 @@
+/*
+ * CSE 351 Lab 4 (Caches and Cache-Friendly Code)
+ * Part 2 - Out-of-Core Matrix Transpose
+ *
+ * Name(s): Joban Mand, Smayan Nirante
+ * NetID(s): jmand1, smayan
+ *
+ * Transposes a matrix stored in a file into another file, for matrices that
+ * do not fit in memory. Both files hold raw row-major 32-bit ints with no
+ * header: the input is M rows of N ints (A[M][N]) and the output is N rows of
+ * M ints (B[N][M] = A^T).
+ *
+ * Both files are memory-mapped. The output is produced in panels of rows,
+ * each panel being a contiguous range of the output file, so the output is
+ * written strictly sequentially. A panel of P output rows is the transpose of
+ * a P-column stripe of the input, which is read with the same square tiling
+ * as transpose_submit in trans.c (each tile row is read into locals and then
+ * scattered into the destination columns).
+ *
+ * The panel height P is chosen so that the panel plus the input stripe it
+ * reads fit in the memory budget. After each panel the output range is
+ * flushed and both the panel and the input pages are dropped from the page
+ * cache mapping with madvise(), which keeps the resident set bounded no
+ * matter how many rows of output there are. P is a whole number of pages of
+ * ints, so a stripe uses all of every input page it faults in and each page
+ * is read from disk once (twice if it straddles two stripes). A stripe
+ * touches at least one page of every input row, so the budget has to be at
+ * least about 3 * M pages; smaller budgets are rejected rather than paying
+ * for a narrower stripe by re-reading the input once per panel. Matrices
+ * with at most a page of ints per row are done as one panel, which needs
+ * room for both whole matrices. Tiles are 16 ints on a side, so each
+ * output row of a tile is one 64-byte line. When compiled with SSE2 and the
+ * output rows are whole lines (M a multiple of 16), each such line is
+ * gathered in registers and written with non-temporal stores, so it bypasses
+ * the cache instead of evicting the input stripe; other shapes and the
+ * partial tiles at the edges use plain stores.
+ *
+ * Build:
+ *   gcc -O2 -std=gnu99 -o trans-stream trans-stream.c
+ *
+ * Usage:
+ *   ./trans-stream [-m budget_MiB] [-c] M N in.bin out.bin
+ *   ./trans-stream -g M N out.bin      (write a test matrix A[i][j] = i*N+j)
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Side length of the square tiles used within a panel: one 64-byte cache
+// line of ints, so every output row of a full tile is exactly one line.
+#define TILE 16
+
+// Default memory budget in MiB
+#define DEFAULT_BUDGET_MIB 256
+
+// Ints written per fwrite() when generating a test matrix
+#define CHUNK_INTS 1024
+
+
+/*
+ * transpose_tile - Copies the transpose of the TILE x TILE block of A at
+ *     (r, c) into B with plain stores. Also handles the partial tiles at the
+ *     right and bottom edges, which end at r_end and c_end.
+ */
+static void transpose_tile(const int32_t* A, int32_t* B, long M, long N,
+                           long r, long r_end, long c, long c_end) {
+  int32_t elements[TILE];
+
+  // Transversing a single tile, one input row at a time
+  for (long rb = r; rb < r_end; rb++) {
+    const int32_t* src = A + rb * N;
+    for (long cb = c; cb < c_end; cb++) {
+      elements[cb - c] = src[cb];
+    }
+    for (long cb = c; cb < c_end; cb++) {
+      B[cb * M + rb] = elements[cb - c];
+    }
+  }
+}
+
+#ifdef __SSE2__
+/*
+ * stream_tile - Same as transpose_tile for a full tile whose output rows are
+ *     64-byte aligned, but gathers each output row (one cache line) in
+ *     registers and writes it with four non-temporal stores, so the line is
+ *     filled in one write-combining buffer and never read into the cache.
+ */
+static void stream_tile(const int32_t* A, int32_t* B, long M, long N,
+                        long r, long c) {
+  for (long k = 0; k < TILE; k += 4) {
+    __m128i lines[4][TILE / 4];
+
+    // Transpose the 4x4 blocks of input columns c+k..c+k+3, giving output
+    // rows c+k..c+k+3 four ints at a time
+    for (long j = 0; j < TILE / 4; j++) {
+      const int32_t* src = A + (r + 4 * j) * N + c + k;
+      __m128i row0 = _mm_loadu_si128((const __m128i*) src);
+      __m128i row1 = _mm_loadu_si128((const __m128i*)(src + N));
+      __m128i row2 = _mm_loadu_si128((const __m128i*)(src + 2 * N));
+      __m128i row3 = _mm_loadu_si128((const __m128i*)(src + 3 * N));
+      __m128i lo01 = _mm_unpacklo_epi32(row0, row1);
+      __m128i hi01 = _mm_unpackhi_epi32(row0, row1);
+      __m128i lo23 = _mm_unpacklo_epi32(row2, row3);
+      __m128i hi23 = _mm_unpackhi_epi32(row2, row3);
+      lines[0][j] = _mm_unpacklo_epi64(lo01, lo23);
+      lines[1][j] = _mm_unpackhi_epi64(lo01, lo23);
+      lines[2][j] = _mm_unpacklo_epi64(hi01, hi23);
+      lines[3][j] = _mm_unpackhi_epi64(hi01, hi23);
+    }
+    for (long i = 0; i < 4; i++) {
+      __m128i* dst = (__m128i*) &B[(c + k + i) * M + r];
+      for (long j = 0; j < TILE / 4; j++) {
+        _mm_stream_si128(dst + j, lines[i][j]);
+      }
+    }
+  }
+}
+#endif
+
+
+/*
+ * transpose_panel - Writes output rows [c0, c0 + rows) of B, i.e. the
+ *     transpose of input columns [c0, c0 + rows) of A. A is M x N and B is
+ *     N x M, both row-major. B must be 64-byte aligned.
+ */
+static void transpose_panel(const int32_t* A, int32_t* B, long M, long N,
+                            long c0, long rows) {
+  long c_end = c0 + rows;
+#ifdef __SSE2__
+  // Output rows start on a line boundary only if a row is whole lines
+  int stream = M % TILE == 0;
+#endif
+
+  for (long r = 0; r < M; r += TILE) {
+    long r_end = (r + TILE < M) ? r + TILE : M;
+    for (long c = c0; c < c_end; c += TILE) {
+      long c_tile_end = (c + TILE < c_end) ? c + TILE : c_end;
+#ifdef __SSE2__
+      if (stream && c_tile_end - c == TILE) {
+        stream_tile(A, B, M, N, r, c);
+        continue;
+      }
+#endif
+      transpose_tile(A, B, M, N, r, r_end, c, c_tile_end);
+    }
+  }
+#ifdef __SSE2__
+  // Order the non-temporal stores before the panel is flushed
+  _mm_sfence();
+#endif
+}
+
+
+/*
+ * panel_rows - Picks how many output rows to produce per panel, or returns 0
+ *     if the budget is below min_budget(). page_ints is the number of ints in
+ *     a page. A panel of P rows keeps P*M output ints resident, and its input
+ *     stripe touches P/page_ints + 1 pages of every input row (rows need not
+ *     start on a page boundary), i.e. up to (P + page_ints)*M input ints.
+ */
+static long panel_rows(long M, long N, size_t budget, long page_ints) {
+  size_t column = sizeof(int32_t) * (size_t) M;   // one output row's bytes
+  long p;
+
+  if (N <= page_ints) {
+    return budget >= 2 * column * (size_t) N ? N : 0;
+  }
+  if (budget < 3 * column * (size_t) page_ints) {
+    return 0;
+  }
+  p = (long)((budget / column - (size_t) page_ints) / 2);
+  p -= p % page_ints;
+  return p < N ? p : N;
+}
+
+/* Returns the smallest budget panel_rows accepts for an M x N matrix. */
+static size_t min_budget(long M, long N, long page_ints) {
+  size_t column = sizeof(int32_t) * (size_t) M;
+  return N <= page_ints ? 2 * column * (size_t) N
+                        : 3 * column * (size_t) page_ints;
+}
+
+
+/*
+ * transpose_file - Transposes the M x N matrix in in_path into out_path using
+ *     at most about budget bytes of resident matrix data. Returns 0 on
+ *     success and -1 on failure (after printing the reason).
+ */
+int transpose_file(const char* in_path, const char* out_path, long M, long N,
+                   size_t budget) {
+  size_t bytes = (size_t) M * N * sizeof(int32_t);
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  long page_ints = (long)(page / sizeof(int32_t));
+  long P = panel_rows(M, N, budget, page_ints);
+  struct stat st;
+  int in_fd, out_fd;
+  int32_t *A, *B;
+  int ret = -1;
+
+  if (P == 0) {
+    fprintf(stderr, "a %ldx%ld matrix needs a budget of at least %zu MiB\n",
+            M, N, (min_budget(M, N, page_ints) + (1 << 20) - 1) >> 20);
+    return -1;
+  }
+
+  in_fd = open(in_path, O_RDONLY);
+  if (in_fd < 0) {
+    perror(in_path);
+    return -1;
+  }
+  if (fstat(in_fd, &st) < 0 || (size_t) st.st_size < bytes) {
+    fprintf(stderr, "%s: expected at least %zu bytes for a %ldx%ld matrix\n",
+            in_path, bytes, M, N);
+    close(in_fd);
+    return -1;
+  }
+
+  out_fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (out_fd < 0) {
+    perror(out_path);
+    close(in_fd);
+    return -1;
+  }
+  if (ftruncate(out_fd, (off_t) bytes) < 0) {
+    perror(out_path);
+    goto out_close;
+  }
+
+  A = mmap(NULL, bytes, PROT_READ, MAP_SHARED, in_fd, 0);
+  if (A == MAP_FAILED) {
+    perror("mmap input");
+    goto out_close;
+  }
+  B = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
+  if (B == MAP_FAILED) {
+    perror("mmap output");
+    munmap(A, bytes);
+    goto out_close;
+  }
+
+  for (long c0 = 0; c0 < N; c0 += P) {
+    long rows = (c0 + P < N) ? P : N - c0;
+    // Page-aligned byte range of the output rows written by this panel
+    size_t start = (size_t) c0 * M * sizeof(int32_t);
+    size_t end = (size_t)(c0 + rows) * M * sizeof(int32_t);
+    start -= start % page;
+
+    transpose_panel(A, B, M, N, c0, rows);
+
+    if (msync((char*) B + start, end - start, MS_SYNC) < 0) {
+      perror("msync");
+      goto out_unmap;
+    }
+    // Drop the finished panel; the part of the last page shared with the
+    // next panel is simply faulted back in.
+    madvise((char*) B + start, end - start, MADV_DONTNEED);
+    // The input stripe touches every row of A, so drop all of it
+    madvise(A, bytes, MADV_DONTNEED);
+  }
+  ret = 0;
+
+out_unmap:
+  munmap(A, bytes);
+  munmap(B, bytes);
+out_close:
+  close(in_fd);
+  if (close(out_fd) < 0) {
+    perror(out_path);
+    ret = -1;
+  }
+  return ret;
+}
+
+
+/* Writes an M x N test matrix with A[i][j] = i*N + j (mod 2^32). */
+static int generate_file(const char* path, long M, long N) {
+  FILE* f = fopen(path, "wb");
+  int32_t row[CHUNK_INTS];
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  for (long i = 0; i < M; i++) {
+    for (long j = 0; j < N; j += CHUNK_INTS) {
+      long n = (j + CHUNK_INTS < N) ? CHUNK_INTS : N - j;
+      for (long k = 0; k < n; k++) {
+        row[k] = (int32_t)(uint32_t)(i * N + j + k);
+      }
+      if (fwrite(row, sizeof(int32_t), (size_t) n, f) != (size_t) n) {
+        perror(path);
+        fclose(f);
+        return -1;
+      }
+    }
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+
+/* Checks that out_path holds the transpose of in_path. Streams through the
+ * output sequentially, so it runs in bounded memory as well. */
+static int check_file(const char* in_path, const char* out_path, long M, long N) {
+  size_t bytes = (size_t) M * N * sizeof(int32_t);
+  int in_fd = open(in_path, O_RDONLY);
+  int out_fd = open(out_path, O_RDONLY);
+  int ok = 0;
+  if (in_fd >= 0 && out_fd >= 0) {
+    const int32_t* A = mmap(NULL, bytes, PROT_READ, MAP_SHARED, in_fd, 0);
+    const int32_t* B = mmap(NULL, bytes, PROT_READ, MAP_SHARED, out_fd, 0);
+    if (A != MAP_FAILED && B != MAP_FAILED) {
+      ok = 1;
+      for (long j = 0; j < N && ok; j++) {
+        for (long i = 0; i < M; i++) {
+          if (B[j * M + i] != A[i * N + j]) {
+            fprintf(stderr, "mismatch at B[%ld][%ld]\n", j, i);
+            ok = 0;
+            break;
+          }
+        }
+      }
+    }
+    if (A != MAP_FAILED) munmap((void*) A, bytes);
+    if (B != MAP_FAILED) munmap((void*) B, bytes);
+  }
+  if (in_fd >= 0) close(in_fd);
+  if (out_fd >= 0) close(out_fd);
+  return ok;
+}
+
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-m budget_MiB] [-c] M N in.bin out.bin\n", prog);
+  fprintf(stderr, "       %s -g M N out.bin\n", prog);
+  fprintf(stderr, "\t-m\tresident memory budget in MiB (default %d)\n",
+          DEFAULT_BUDGET_MIB);
+  fprintf(stderr, "\t-c\tverify the output after transposing\n");
+  fprintf(stderr, "\t-g\tgenerate a test input matrix\n");
+}
+
+
+int main(int argc, char* argv[]) {
+  size_t budget = (size_t) DEFAULT_BUDGET_MIB << 20;
+  int check = 0;
+  int generate = 0;
+  long M, N;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "m:cgh")) != -1) {
+    switch (opt) {
+      case 'm':
+        budget = (size_t) atol(optarg) << 20;
+        break;
+      case 'c':
+        check = 1;
+        break;
+      case 'g':
+        generate = 1;
+        break;
+      default:
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - optind != (generate ? 3 : 4)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  M = atol(argv[optind]);
+  N = atol(argv[optind + 1]);
+  if (M <= 0 || N <= 0) {
+    fprintf(stderr, "matrix dimensions must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  if (generate) {
+    return generate_file(argv[optind + 2], M, N) == 0 ? EXIT_SUCCESS
+                                                      : EXIT_FAILURE;
+  }
+
+  if (transpose_file(argv[optind + 2], argv[optind + 3], M, N, budget) < 0) {
+    return EXIT_FAILURE;
+  }
+  if (check) {
+    if (!check_file(argv[optind + 2], argv[optind + 3], M, N)) {
+      printf("Transpose incorrect\n");
+      return EXIT_FAILURE;
+    }
+    printf("Transpose correct\n");
+  }
+  return EXIT_SUCCESS;
+}